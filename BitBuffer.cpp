@@ -3,34 +3,63 @@
 #include <fstream>
 #include <stdexcept>
 #include <source_location>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace outbit {
     namespace fs = std::filesystem;
 
-    IndexedSpan::IndexedSpan(std::size_t offset, std::size_t count)
-        : m_offset(offset), m_count{count}
+    BitBuffer::BitBuffer(BufferMode mode)
+        : m_mode(mode)
     {
     }
 
-    std::optional<IndexedSpan> IndexedSpan::subspan(std::size_t offset) {
-        // Subspan is outside
-        if (offset > m_count) {
-            return std::nullopt;
+    BitBuffer::BitBuffer(std::pmr::memory_resource* resource, BufferMode mode)
+        : m_buffer(resource), m_mode(mode)
+    {
+    }
+
+    void BitBuffer::reserve(std::size_t n_bytes) {
+        auto old_capacity = m_buffer.capacity();
+        m_buffer.reserve(n_bytes);
+        if (m_buffer.capacity() != old_capacity) {
+            m_stats.count_reallocation(old_capacity, m_buffer.capacity(), m_buffer.size());
         }
+    }
 
-        return subspan(offset, m_count - offset);
+    void BitBuffer::shrink_to_fit() {
+        this->flush_pending_bits();
+        if (m_mode == BufferMode::fifo) {
+            this->drop_read_bytes();
+        }
+
+        m_buffer.shrink_to_fit();
     }
 
-    std::optional<IndexedSpan> IndexedSpan::subspan(std::size_t offset, std::size_t count) {
-        // Subspan is outside
-        if (offset + count > m_count) {
-            return std::nullopt;
+    // Erases the bytes that were completely read and shifts the read position.
+    void BitBuffer::drop_read_bytes() {
+        // A sought position may lie in the bits not flushed yet.
+        auto n_bytes = std::min(this->read_position() / BYTE_BITS, m_buffer.size());
+        if (n_bytes == 0) {
+            return;
         }
 
-        return IndexedSpan(m_offset + offset, count);
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(n_bytes));
+        m_dropped_bytes += n_bytes;
+        m_stats.count_copy(m_buffer.size());
+
+        if (m_reload_position) {
+            *m_reload_position -= n_bytes * BYTE_BITS;
+        } else {
+            m_read_window.move_input(m_read_window.next_byte() - n_bytes);
+        }
     }
 
     void BitBuffer::write_as_file(const fs::path& filepath, const std::source_location caller_location) {
+        auto start = StatsRecorder::now();
         auto options = std::fstream::out | std::fstream::trunc| std::fstream::binary;
         auto output_file = std::fstream(filepath, options);
 
@@ -47,15 +76,19 @@ namespace outbit {
             throw std::runtime_error(erro_msg);
         }
 
+        this->flush_pending_bits();
+        auto bytes = this->input();
         output_file.write(
-            reinterpret_cast<const char*>(m_buffer.data()), 
-            std::streamsize(m_buffer.size())
+            reinterpret_cast<const char*>(bytes.data()), 
+            std::streamsize(bytes.size())
         );
 
         output_file.close();
+        m_stats.count_file_io(FileOperation::write, filepath, bytes.size(), start);
     }
 
     void BitBuffer::read_from_file(const fs::path& filepath, const std::source_location caller_location) {
+        auto start = StatsRecorder::now();
         auto input_stream = std::ifstream(filepath, std::fstream::binary);
 
         if (!fs::is_regular_file(filepath)) {
@@ -71,16 +104,98 @@ namespace outbit {
             throw std::runtime_error(erro_msg);
         }
 
-        m_buffer = std::vector<u8>(
+        m_buffer.assign(
             std::istreambuf_iterator<char>(input_stream),
             std::istreambuf_iterator<char>()
             );
+        m_mapped_file.reset();
+        m_accumulator.clear();
 
-        m_buffer_slice = IndexedSpan(0, m_buffer.size());
+        m_read_window.rewind();
+        m_reload_position.reset();
+        m_dropped_bytes = 0;
 
-        if (!m_buffer.empty()) {
-            m_unread_bits_of_head_byte = BYTE_BITS;
+        m_used_length_of_tail_byte = m_buffer.empty() ? 0 : BYTE_BITS;
+
+        m_stats.count_file_io(FileOperation::read, filepath, m_buffer.size(), start);
+    }
+
+    void BitBuffer::read_from_file(const fs::path& filepath, const MapOptions& options,
+            const std::source_location caller_location) {
+        auto start = StatsRecorder::now();
+        m_mapped_file = std::make_shared<const MappedFile>(filepath, options, caller_location);
+        m_buffer = Bytes(m_buffer.get_allocator());
+        m_accumulator.clear();
+
+        m_read_window.rewind();
+        m_reload_position.reset();
+        m_dropped_bytes = 0;
+
+        m_used_length_of_tail_byte = m_mapped_file->bytes().empty() ? 0 : BYTE_BITS;
+        m_stats.count_file_io(FileOperation::read, filepath, m_mapped_file->bytes().size(), start);
+    }
+
+    MappedFile::MappedFile(const fs::path& filepath, const MapOptions& options,
+            const std::source_location caller_location) {
+        auto callee_location = std::source_location::current();
+        auto map_error = [&](std::string_view reason) {
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to map '{}'. {}.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        filepath.string(),
+                        reason);
+
+            return std::runtime_error(erro_msg);
+        };
+
+        auto file_descriptor = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file_descriptor < 0) {
+            throw map_error(std::strerror(errno));
+        }
+
+        struct stat file_status = {};
+        if (::fstat(file_descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+            ::close(file_descriptor);
+            throw map_error("Not a regular file");
         }
+
+        // Empty files cannot be mapped, they are simply left unmapped.
+        m_size = static_cast<std::size_t>(file_status.st_size);
+        if (m_size > 0) {
+            m_address = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (m_address == MAP_FAILED) {
+                m_address = nullptr;
+                auto reason = std::string(std::strerror(errno));
+                ::close(file_descriptor);
+                throw map_error(reason);
+            }
+
+            // These are hints, the mapping is usable even if they fail.
+            if (options.sequential) {
+                ::madvise(m_address, m_size, MADV_SEQUENTIAL);
+            }
+#ifdef MADV_HUGEPAGE
+            if (options.huge_pages) {
+                ::madvise(m_address, m_size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        // The mapping keeps its own reference to the file.
+        ::close(file_descriptor);
+    }
+
+    MappedFile::~MappedFile() {
+        if (m_address != nullptr) {
+            ::munmap(m_address, m_size);
+        }
+    }
+
+    std::span<const u8> MappedFile::bytes() const {
+        return std::span<const u8>(static_cast<const u8*>(m_address), m_size);
     }
 
     std::size_t BitBuffer::from_bits_to_bytes_length(std::size_t bits_length) {
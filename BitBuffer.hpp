@@ -13,44 +13,74 @@
 #include <span>
 #include <algorithm>
 #include <cstdio>
+#include <array>
+#include <bit>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
+#include "BitEngine.hpp"
+#include "BitPacking.hpp"
+#include "Record.hpp"
+#include "BufferStats.hpp"
 
 namespace outbit {
     namespace fs = std::filesystem;
-    const int BYTE_BITS = 8;
 
-    using u8 = uint8_t;
-    using s8 = int8_t;
+    struct MapOptions {
+        // Tell the kernel the pages are read in order ('MADV_SEQUENTIAL'),
+        // so it reads ahead aggressively and drops pages behind the reader.
+        bool sequential = true;
+        // Ask for transparent huge pages ('MADV_HUGEPAGE') where supported.
+        bool huge_pages = false;
+    };
 
-    class IndexedSpan {
+    // Read-only memory mapping of a whole file.
+    class MappedFile {
         public:
-            IndexedSpan() = default;
-            IndexedSpan(std::size_t offset, std::size_t count);
-            template<typename T>
-            std::optional<std::span<T>> get_span_from_vector(std::vector<T>& vec);
-            bool empty() { return m_count == 0; }
-            std::size_t offset() { return m_offset; }
-            std::optional<IndexedSpan> subspan(std::size_t offset);
-            std::optional<IndexedSpan> subspan(std::size_t offset, std::size_t count);
+            MappedFile(const fs::path& filepath, const MapOptions& options,
+                    std::source_location = std::source_location::current());
+            ~MappedFile();
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            std::span<const u8> bytes() const;
+
         private:
-            std::size_t m_offset;
-            std::size_t m_count;
+            void* m_address = nullptr;
+            std::size_t m_size = 0;
     };
 
-    template<typename T>
-    std::optional<std::span<T>> IndexedSpan::get_span_from_vector(std::vector<T>& vec) {
-        if (m_offset + m_count > vec.size()) {
-            return std::nullopt;
-        }
-
-        return std::span<T>(vec.data(), vec.size())
-            .subspan(m_offset, m_count);
-    }
+    enum class BufferMode {
+        // Every write moves the read position back to the start of the
+        // buffer, so the whole buffer can be read back after writing it.
+        rewind_on_write,
+        // Reads consume the bits written before them, in order. The bytes
+        // already read are dropped before the buffer grows, so memory
+        // follows the amount of unread data.
+        fifo,
+    };
 
     class BitBuffer {
         public:
+            // Storage of the written bytes, allocated from the memory
+            // resource given at construction (the default one otherwise).
+            using Bytes = std::pmr::vector<u8>;
+
             BitBuffer() = default;
+            explicit BitBuffer(BufferMode mode);
+            // 'resource', such as a 'std::pmr::monotonic_buffer_resource'
+            // arena, must outlive the buffer. Moves keep the resource,
+            // copies allocate from the default one.
+            explicit BitBuffer(std::pmr::memory_resource* resource,
+                    BufferMode mode = BufferMode::rewind_on_write);
             void read_from_file(const fs::path& filepath,
                     std::source_location = std::source_location::current());
+            // Maps the file instead of copying it. Pages are loaded on demand
+            // as they are read. The mapping is copied into the buffer only if
+            // the buffer is written to or accessed through 'buffer()'.
+            void read_from_file(const fs::path& filepath, const MapOptions& options,
+                    std::source_location = std::source_location::current());
 
             template<typename T>
             void read_from_span(std::span<T> slice);
@@ -64,38 +94,176 @@ namespace outbit {
             void write_as_file(const fs::path&,
                     std::source_location = std::source_location::current());
 
-            template<typename T, std::size_t N = sizeof(T)> static
+            // Both can run at compile time.
+            template<typename T, std::size_t N = sizeof(T)> static constexpr
             std::array<u8, N> serialize(const T& item);
 
             template<std::size_t N,
                 std::size_t B = BitBuffer::constexpr_from_bits_to_bytes_length(N)>
-            static std::array<u8, B> serialize_bitset(const std::bitset<N>& bits);
+            static constexpr std::array<u8, B> serialize_bitset(const std::bitset<N>& bits);
 
             template<typename T>
             T read_as();
             template<typename T>
             T read_bits_as(std::size_t n_bits);
 
+            // Returns the next 'n_bits' (at most 56) without moving the read
+            // position. Bits past the written ones read as zeros.
+            inline u64 peek_bits(std::size_t n_bits);
+            // Moves the read position by 'n_bits' (at most 56).
+            inline void consume_bits(std::size_t n_bits);
+            // Calls 'reader(window, input)' with a copy of the read window
+            // and the buffer bytes, then continues reading from where the
+            // copy stopped. Decoders reading many fields in a row keep the
+            // window in registers this way. 'reader' must not modify the buffer.
+            template<typename Reader>
+            void read_with(Reader&& reader);
+
+            // Random access to the read position, in bits from the first
+            // bit of the buffer. All of them take constant time. In
+            // 'BufferMode::fifo' the positions keep counting the bytes that
+            // were dropped, which can no longer be sought to.
+            inline std::size_t tell_bits() const;
+            inline void seek_bits(std::size_t position);
+            inline void skip_bits(std::size_t n_bits);
+
             template<typename T>
             void write(const T& item);
 
             template<typename T>
             void write_bits(const T& item, std::size_t n_bits);
+
+            // Same as 'write_bits' and 'read_bits_as', with the width fixed
+            // at compile time. Widths larger than 'T' do not compile.
+            template<std::size_t N, typename T>
+            void write_bits(const T& item);
+            template<std::size_t N, typename T>
+            T read_bits();
+
+            // Stores only the fields of 'Schema' (see Record.hpp), with
+            // their offsets and masks resolved at compile time.
+            template<typename Schema>
+            void write_record(const typename Schema::record_type& record);
+            template<typename Schema>
+            typename Schema::record_type read_record();
+
+            // Same as calling 'write_bits(value, width)', or 'read_bits_as<T>(width)',
+            // for every '{value, width}' pair in order. The words of the batch
+            // are reserved once and packed in a register.
+            template<typename... T, typename... W>
+            void write_fields(const std::pair<T, W>&... fields);
+            template<typename... T, typename... W>
+            std::tuple<T...> read_fields(W... widths);
+
+            // Same as calling 'write_bits(value, width)', or 'read_bits_as<T>(width)',
+            // for every value, through kernels specialized for each width up to 32.
+            template<typename T>
+            void write_packed(std::span<const T> values, std::size_t width);
+            template<typename T>
+            void read_packed(std::span<T> values, std::size_t width);
+            // Same as calling 'write(byte)' for every byte. The bytes are
+            // copied at once when the written bits end on a byte boundary.
+            inline void write_bytes(std::span<const u8> bytes);
+
+            // Variable-length integer codes. The unary code of 'value' is
+            // 'value' zeros followed by a one, so that decoding counts the
+            // trailing zeros of the read window (the stream is LSB-first).
+            inline void write_unary(u64 value);
+            // Unary quotient of 'value >> k', then its 'k' low bits.
+            inline void write_rice(u64 value, std::size_t k);
+            // Order-0 Exp-Golomb. 'value' must be below 2^64 - 1.
+            inline void write_exp_golomb(u64 value);
+            // Groups of 7 bits, low group first, in whole bytes. The writing
+            // position is first padded with zeros to the next byte boundary.
+            inline void write_leb128(u64 value);
+            // LEB128 of the zigzag mapping of 'value'.
+            inline void write_zigzag(int64_t value);
+
+            inline u64 read_unary();
+            inline u64 read_rice(std::size_t k);
+            inline u64 read_exp_golomb();
+            inline u64 read_leb128();
+            inline int64_t read_zigzag();
+
             inline std::optional<u8> tail_byte();
-            inline const std::vector<u8>& buffer();
+            // In 'BufferMode::fifo' the buffer may still start with bytes
+            // that were read but not dropped yet. The bytes are allocated
+            // from the memory resource of the buffer.
+            inline const Bytes& buffer();
+            // Same bytes as 'buffer', without copying a mapped file. The
+            // span is invalidated by the next write.
+            inline std::span<const u8> bytes();
+
+            // Number of bits written, counted like 'tell_bits'.
+            inline std::size_t size_in_bits() const;
+            inline std::size_t unread_bits() const;
+            void reserve(std::size_t n_bytes);
+            inline std::pmr::memory_resource* resource() const;
+            // In 'BufferMode::fifo' the bytes already read are dropped first.
+            void shrink_to_fit();
+
+            // Counters since construction or the last 'reset_stats', see
+            // BufferStats.hpp. All zeros unless 'OUTBIT_ENABLE_STATS' is defined.
+            BufferStats stats() const { return m_stats.snapshot(); }
+            void reset_stats() { m_stats.reset(); }
+            void set_hooks(BufferHooks hooks) { m_stats.set_hooks(std::move(hooks)); }
 
         private:
-            std::vector<u8> m_buffer;
-            IndexedSpan m_buffer_slice;
+            inline std::size_t written_bits() const;
+            inline std::size_t read_position() const;
+            inline void sync_read_window();
+            inline void make_room(std::size_t n_bytes);
+            void drop_read_bytes();
+            inline void adopt_tail_byte();
+            inline void begin_write();
+            inline void end_write();
+            inline void spill_word(u64 word);
+            inline void flush_pending_bits();
+
+            inline std::span<const u8> input() const;
+            inline void detach_mapped_file();
+
+            Bytes m_buffer;
             std::size_t m_used_length_of_tail_byte = 0;
-            std::size_t m_unread_bits_of_head_byte = 0;
+            // When set, it holds the buffer contents and 'm_buffer' is empty.
+            std::shared_ptr<const MappedFile> m_mapped_file;
+
+            // Write engine state. Bits are staged LSB-first in a 64-bit
+            // register and only reach 'm_buffer' as whole words, or when
+            // the buffer is observed (see 'flush_pending_bits').
+            BitAccumulator m_accumulator;
+
+            BitWindow m_read_window;
+            // Set when the read window loaded a tail byte that was written to
+            // afterwards. It is reloaded from this position on the next read.
+            std::optional<std::size_t> m_reload_position;
+            BufferMode m_mode = BufferMode::rewind_on_write;
+            // Bytes erased from the front of 'm_buffer' in 'BufferMode::fifo'.
+            std::size_t m_dropped_bytes = 0;
+            StatsRecorder m_stats;
     };
 
-    const std::vector<u8>& BitBuffer::buffer() {
+    auto BitBuffer::buffer() -> const Bytes& {
+        this->detach_mapped_file();
+        this->flush_pending_bits();
         return m_buffer;
     }
 
+    std::pmr::memory_resource* BitBuffer::resource() const {
+        return m_buffer.get_allocator().resource();
+    }
+
+    std::span<const u8> BitBuffer::bytes() {
+        this->flush_pending_bits();
+        return this->input();
+    }
+
     std::optional<u8> BitBuffer::tail_byte() {
+        if (m_mapped_file && !m_mapped_file->bytes().empty()) {
+            return std::optional<u8>{m_mapped_file->bytes().back()};
+        }
+
+        this->flush_pending_bits();
         if (!m_buffer.empty()) {
             return std::optional<u8>{m_buffer.back()};
         } 
@@ -103,19 +271,150 @@ namespace outbit {
         return std::nullopt;
     }
 
+    std::size_t BitBuffer::written_bits() const {
+        if (m_mapped_file) {
+            return m_mapped_file->bytes().size() * BYTE_BITS;
+        }
+
+        auto buffer_bits = m_buffer.size() * BYTE_BITS;
+        if (m_used_length_of_tail_byte > 0 && m_used_length_of_tail_byte < BYTE_BITS) {
+            buffer_bits -= BYTE_BITS - m_used_length_of_tail_byte;
+        }
+
+        return buffer_bits + m_accumulator.size();
+    }
+
+    std::size_t BitBuffer::size_in_bits() const {
+        return m_dropped_bytes * BYTE_BITS + this->written_bits();
+    }
+
+    std::size_t BitBuffer::unread_bits() const {
+        return this->written_bits() - this->read_position();
+    }
+
+    std::size_t BitBuffer::read_position() const {
+        return m_reload_position.value_or(m_read_window.position());
+    }
+
+    void BitBuffer::sync_read_window() {
+        if (m_reload_position) {
+            m_read_window.seek(this->input(), *m_reload_position);
+            m_reload_position.reset();
+        }
+    }
+
+    // In 'BufferMode::fifo', reuses the space of the bytes already read when
+    // they make up at least half of the buffer, instead of growing it.
+    // Otherwise grows the buffer geometrically, like 'std::vector' would.
+    void BitBuffer::make_room(std::size_t n_bytes) {
+        if (m_buffer.size() + n_bytes <= m_buffer.capacity()) {
+            return;
+        }
+
+        if (m_mode == BufferMode::fifo && this->read_position() / BYTE_BITS * 2 >= m_buffer.size()) {
+            this->drop_read_bytes();
+            if (m_buffer.size() + n_bytes <= m_buffer.capacity()) {
+                return;
+            }
+        }
+
+        auto old_capacity = m_buffer.capacity();
+        m_buffer.reserve(std::max(2 * old_capacity, m_buffer.size() + n_bytes));
+        m_stats.count_reallocation(old_capacity, m_buffer.capacity(), m_buffer.size());
+    }
+
+    // Moves a partially used tail byte back into the register, so the
+    // buffer only ever receives whole bytes from the accumulator.
+    void BitBuffer::adopt_tail_byte() {
+        if (m_accumulator.size() == 0
+                && !m_buffer.empty()
+                && m_used_length_of_tail_byte > 0
+                && m_used_length_of_tail_byte < BYTE_BITS) {
+            // The read window may hold the unused bits of the tail byte as zeros.
+            if (m_read_window.next_byte() == m_buffer.size() && !m_reload_position) {
+                m_reload_position = m_read_window.position();
+            }
+
+            m_accumulator.push(m_buffer.back(), m_used_length_of_tail_byte, [](u64) {});
+            m_buffer.pop_back();
+            m_used_length_of_tail_byte = m_buffer.empty() ? 0 : BYTE_BITS;
+        }
+    }
+
+    void BitBuffer::begin_write() {
+        this->detach_mapped_file();
+        this->adopt_tail_byte();
+    }
+
+    void BitBuffer::end_write() {
+        // Reads restart from the beginning of the buffer after a write.
+        if (m_mode == BufferMode::rewind_on_write) {
+            m_read_window.rewind();
+            m_reload_position.reset();
+        }
+    }
+
+    void BitBuffer::spill_word(u64 word) {
+        this->make_room(sizeof(u64));
+        auto word_bytes = store_word(word);
+        m_buffer.insert(m_buffer.end(), word_bytes.begin(), word_bytes.end());
+        m_used_length_of_tail_byte = BYTE_BITS;
+    }
+
+    // Moves the staged bits into 'm_buffer'. The last byte may be partial,
+    // exactly as if the bits had been written one by one.
+    void BitBuffer::flush_pending_bits() {
+        auto staged_bits = m_accumulator.size();
+        if (staged_bits == 0) {
+            return;
+        }
+
+        auto word_bytes = store_word(m_accumulator.bits());
+        auto n_bytes = BitBuffer::constexpr_from_bits_to_bytes_length(staged_bits);
+        this->make_room(n_bytes);
+        m_buffer.insert(m_buffer.end(), word_bytes.begin(), word_bytes.begin() + n_bytes);
+
+        if (staged_bits % BYTE_BITS) {
+            m_used_length_of_tail_byte = staged_bits % BYTE_BITS;
+        } else {
+            m_used_length_of_tail_byte = BYTE_BITS;
+        }
+
+        m_accumulator.clear();
+    }
+
+    std::span<const u8> BitBuffer::input() const {
+        if (m_mapped_file) {
+            return m_mapped_file->bytes();
+        }
+
+        return std::span<const u8>(m_buffer.data(), m_buffer.size());
+    }
+
+    // Copies the mapped file into 'm_buffer', so it can be modified.
+    void BitBuffer::detach_mapped_file() {
+        if (!m_mapped_file) {
+            return;
+        }
+
+        auto mapped_bytes = m_mapped_file->bytes();
+        m_buffer.assign(mapped_bytes.begin(), mapped_bytes.end());
+        m_stats.count_copy(mapped_bytes.size());
+        m_mapped_file.reset();
+    }
+
     template<typename T, std::size_t N>
-    std::array<u8, N> BitBuffer::serialize(const T &item) {
-        auto* addr = const_cast<u8*>(reinterpret_cast<const u8*>(&item));
-        auto item_bytes = sizeof(T);
+    constexpr std::array<u8, N> BitBuffer::serialize(const T &item) {
+        auto item_bytes = std::bit_cast<std::array<u8, sizeof(T)>>(item);
 
         auto serialized = std::array<u8, N>();
-        std::memcpy(serialized.data(), addr, item_bytes);
+        copy_bytes(serialized.data(), item_bytes.data(), std::min(N, sizeof(T)));
         return serialized;
     }
 
     // TODO: Write a test.
     template<std::size_t N, std::size_t B>
-    std::array<u8, B> BitBuffer::serialize_bitset(const std::bitset<N>& bits) {
+    constexpr std::array<u8, B> BitBuffer::serialize_bitset(const std::bitset<N>& bits) {
         static_assert(N % 8 == 0,
                 "Invalid std::bitset<N> argument. Length 'N' must be multiple of 8.");
 
@@ -145,55 +444,82 @@ namespace outbit {
     // TODO: change the return value to std::optional<T>
     template<typename T>
     T BitBuffer::read_bits_as(std::size_t n_bits) {
-        const std::size_t item_bits_lenght = sizeof(T) * BYTE_BITS;
+        [[maybe_unused]] const std::size_t item_bits_lenght = sizeof(T) * BYTE_BITS;
         assert(n_bits <= item_bits_lenght);
 
-        // FIXME: check if its necessary to use these additional 16 bits.
-        auto item_bits = std::bitset<item_bits_lenght + BYTE_BITS * std::size_t(2)>();
+        this->flush_pending_bits();
+        this->sync_read_window();
 
-        // The current head byte must always have unread bits
-        assert(m_unread_bits_of_head_byte > 0);
+        // The bits being read must have been written
+        assert(m_read_window.position() + n_bits <= this->written_bits());
 
-        auto head_read_bits = BYTE_BITS - m_unread_bits_of_head_byte;
-        assert(std::size_t(head_read_bits) < 8); // just checking
-        const auto n_bytes = BitBuffer::from_bits_to_bytes_length(n_bits + head_read_bits);
+        m_stats.count_read(n_bits);
+        return m_read_window.read_bits_as<T>(this->input(), n_bits);
+    }
 
-        assert(!m_buffer_slice.empty());
-        //assert(m_buffer_slice.data() >= m_buffer.data());
-        auto subspan = m_buffer_slice.subspan(0, n_bytes).value();
-        auto item_slice = subspan.get_span_from_vector(m_buffer).value();
+    u64 BitBuffer::peek_bits(std::size_t n_bits) {
+        this->flush_pending_bits();
+        this->sync_read_window();
 
-        // Fill 'item_bits'
-        for (auto [byte_index, byte] : std::views::enumerate(item_slice)) {
-             auto byte_bits = std::bitset<BYTE_BITS>{byte};
-            for (int bit_index = 0; bit_index < BYTE_BITS; bit_index++) {
-                // The 'bitset::test' function performs a bounds check
-                item_bits.test(byte_index * BYTE_BITS + bit_index);
-                item_bits[byte_index * BYTE_BITS + bit_index] = byte_bits.test(bit_index);
-            }
-        }
+        return m_read_window.peek_bits(this->input(), n_bits);
+    }
+
+    void BitBuffer::consume_bits(std::size_t n_bits) {
+        this->flush_pending_bits();
+        this->sync_read_window();
 
-        // Remove the bits that were alwready read.
-        item_bits >>= head_read_bits;
+        // The bits being read must have been written
+        assert(m_read_window.position() + n_bits <= this->written_bits());
 
-        if ((head_read_bits + n_bits) % 8) {
-            // m_buffer_slice = m_buffer_slice.subspan(n_bytes - 1);
-            m_buffer_slice = m_buffer_slice.subspan(n_bytes - 1).value();
-            m_unread_bits_of_head_byte = BYTE_BITS - (head_read_bits + n_bits) % 8;
+        m_stats.count_read(n_bits);
+        if (n_bits <= m_read_window.window_bits()) {
+            m_read_window.consume_bits(n_bits);
         } else {
-            // m_buffer_slice = m_buffer_slice.subspan(n_bytes);
-            m_buffer_slice = m_buffer_slice.subspan(n_bytes).value();
-            m_unread_bits_of_head_byte = BYTE_BITS;
+            m_read_window.take_bits(this->input(), n_bits);
         }
+    }
+
+    template<typename Reader>
+    void BitBuffer::read_with(Reader&& reader) {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto window = m_read_window;
+        reader(window, this->input());
+        m_stats.count_read(window.position() - m_read_window.position());
+        m_read_window = window;
+
+        // The bits being read must have been written
+        assert(m_read_window.position() <= this->written_bits());
+    }
+
+    std::size_t BitBuffer::tell_bits() const {
+        return m_dropped_bytes * BYTE_BITS + this->read_position();
+    }
+
+    // The window is moved by the next read, see 'sync_read_window'.
+    void BitBuffer::seek_bits(std::size_t position) {
+        assert(position >= m_dropped_bytes * BYTE_BITS);
+
+        position -= m_dropped_bytes * BYTE_BITS;
+
+        // The bits being sought must have been written
+        assert(position <= this->written_bits());
 
-        assert(m_unread_bits_of_head_byte <= 8);
+        m_reload_position = position;
+    }
+
+    void BitBuffer::skip_bits(std::size_t n_bits) {
+        if (!m_reload_position && n_bits <= m_read_window.window_bits()
+                && n_bits <= WORD_BITS - BYTE_BITS) {
+            // The bits being skipped must have been written
+            assert(this->read_position() + n_bits <= this->written_bits());
 
-        auto all_one_bits = std::bitset<item_bits_lenght + BYTE_BITS * std::size_t(2)>{0}.flip();
-        auto valid_bits = (all_one_bits << n_bits).flip();
-        auto read_bits = item_bits & valid_bits;
-        auto output = BitBuffer::serialize_bitset(read_bits);
+            m_read_window.consume_bits(n_bits);
+            return;
+        }
 
-        return *reinterpret_cast<T*>(output.data());
+        this->seek_bits(this->tell_bits() + n_bits);
     }
 
     template<typename T>
@@ -203,82 +529,362 @@ namespace outbit {
 
     template<typename T>
     void BitBuffer::write_bits(const T &item, std::size_t n_bits) {
-        const std::size_t item_bits_lenght = sizeof(T) * BYTE_BITS;
+        [[maybe_unused]] const std::size_t item_bits_lenght = sizeof(T) * BYTE_BITS;
         assert(n_bits <= item_bits_lenght);
-        
-        // We add 8 bits to be able to do a right bit shift
-        // and place the tail byte used bits at the beggining of the
-        // bitset if necessary.
-        auto item_bits = std::bitset<item_bits_lenght + BYTE_BITS>{};
-
-        // Fill 'item_bits'
-        auto serialized = BitBuffer::serialize(item);
-        for (auto [byte_index, byte] : std::views::enumerate(serialized)) {
-             auto byte_bits = std::bitset<BYTE_BITS>{byte};
-            for (int bit_index = 0; bit_index < BYTE_BITS; bit_index++) {
-                // The 'bitset::test' function performs a bounds check
-                item_bits.test(byte_index * BYTE_BITS + bit_index);
-                item_bits[byte_index * BYTE_BITS + bit_index] = byte_bits.test(bit_index);
-            }
+
+        m_stats.count_write(n_bits);
+        this->begin_write();
+        m_accumulator.push_item(item, n_bits, [this](u64 word) {
+            this->spill_word(word);
+        });
+        this->end_write();
+    }
+
+    template<std::size_t N, typename T>
+    void BitBuffer::write_bits(const T &item) {
+        m_stats.count_write(N);
+        this->begin_write();
+        m_accumulator.push_item<N>(item, [this](u64 word) {
+            this->spill_word(word);
+        });
+        this->end_write();
+    }
+
+    template<std::size_t N, typename T>
+    T BitBuffer::read_bits() {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        // The bits being read must have been written
+        assert(m_read_window.position() + N <= this->written_bits());
+
+        m_stats.count_read(N);
+        return m_read_window.read_bits<N, T>(this->input());
+    }
+
+    template<typename Schema>
+    void BitBuffer::write_record(const typename Schema::record_type& record) {
+        auto words = Schema::pack(record);
+
+        m_stats.count_write(Schema::size_in_bits);
+        this->begin_write();
+        auto spill = [this](u64 word) {
+            this->spill_word(word);
+        };
+
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (m_accumulator.push(words[I], I + 1 < Schema::n_words ? WORD_BITS : Schema::tail_bits, spill), ...);
+        }(std::make_index_sequence<Schema::n_words>{});
+        this->end_write();
+    }
+
+    template<typename Schema>
+    typename Schema::record_type BitBuffer::read_record() {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        // The bits being read must have been written
+        assert(m_read_window.position() + Schema::size_in_bits <= this->written_bits());
+        m_stats.count_read(Schema::size_in_bits);
+
+        auto input = this->input();
+        auto words = typename Schema::Words();
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            ((words[I] = m_read_window.read_bits<I + 1 < Schema::n_words ? WORD_BITS : Schema::tail_bits, u64>(input)), ...);
+        }(std::make_index_sequence<Schema::n_words>{});
+
+        return Schema::unpack(words);
+    }
+
+    template<typename... T, typename... W>
+    void BitBuffer::write_fields(const std::pair<T, W>&... fields) {
+        static_assert((std::is_integral_v<W> && ...), "Field widths must be integers.");
+        assert(((static_cast<std::size_t>(fields.second) <= sizeof(T) * BYTE_BITS) && ...));
+
+        const std::size_t n_bits = (static_cast<std::size_t>(fields.second) + ... + 0);
+        m_stats.count_write(n_bits);
+        this->begin_write();
+
+        auto n_bytes = (m_accumulator.size() + n_bits) / WORD_BITS * sizeof(u64);
+        this->make_room(n_bytes);
+
+        auto buffer_size = m_buffer.size();
+        m_buffer.resize(buffer_size + n_bytes);
+        auto* out = m_buffer.data() + buffer_size;
+        auto accumulator = m_accumulator;
+        auto spill = [&out](u64 word) {
+            auto word_bytes = store_word(word);
+            std::memcpy(out, word_bytes.data(), word_bytes.size());
+            out += word_bytes.size();
+        };
+
+        (accumulator.push_item(fields.first, static_cast<std::size_t>(fields.second), spill), ...);
+        assert(out == m_buffer.data() + m_buffer.size());
+        m_accumulator = accumulator;
+
+        if (n_bytes > 0) {
+            m_used_length_of_tail_byte = BYTE_BITS;
         }
 
-        std::size_t output_valid_bits_lenght;
-        if (m_used_length_of_tail_byte > 0 && m_used_length_of_tail_byte < BYTE_BITS) {
-            
-            u8 tail_byte = this->tail_byte().value();
-            auto tail_bits = std::bitset<item_bits_lenght + BYTE_BITS>{tail_byte};
+        this->end_write();
+    }
 
-            // Create room to the bits of the tail byte.
-            item_bits <<= m_used_length_of_tail_byte;
-            item_bits |= tail_bits;
+    template<typename... T, typename... W>
+    std::tuple<T...> BitBuffer::read_fields(W... widths) {
+        static_assert(sizeof...(T) == sizeof...(W), "One width is needed per field.");
+        static_assert((std::is_integral_v<W> && ...), "Field widths must be integers.");
 
-            m_buffer.pop_back();
+        const std::size_t n_bits = (static_cast<std::size_t>(widths) + ... + 0);
 
-            output_valid_bits_lenght = m_used_length_of_tail_byte + n_bits;
-        } else {
-            output_valid_bits_lenght = n_bits;
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        // The bits being read must have been written
+        assert(m_read_window.position() + n_bits <= this->written_bits());
+        m_stats.count_read(n_bits);
+
+        // Braces evaluate the reads in order.
+        auto input = this->input();
+        auto window = m_read_window;
+        auto fields = std::tuple<T...>{ window.read_bits_as<T>(input, static_cast<std::size_t>(widths))... };
+        m_read_window = window;
+
+        return fields;
+    }
+
+    template<typename T>
+    void BitBuffer::write_packed(std::span<const T> values, std::size_t width) {
+        static_assert(std::is_integral_v<T>);
+        assert(width <= MAX_PACKED_WIDTH && width <= sizeof(T) * BYTE_BITS);
+
+        m_stats.count_write(values.size() * width);
+        this->begin_write();
+
+        // The words spilled by the kernel are stored in place.
+        auto n_words = (m_accumulator.size() + values.size() * width) / WORD_BITS;
+        auto n_bytes = n_words * sizeof(u64);
+        this->make_room(n_bytes);
+
+        auto buffer_size = m_buffer.size();
+        m_buffer.resize(buffer_size + n_bytes);
+        [[maybe_unused]] auto* end = pack_kernel<T>(width)(
+                values.data(), values.size(), m_accumulator, m_buffer.data() + buffer_size);
+        assert(end == m_buffer.data() + m_buffer.size());
+
+        if (n_bytes > 0) {
+            m_used_length_of_tail_byte = BYTE_BITS;
         }
 
-        auto all_one_bits = std::bitset<item_bits_lenght + BYTE_BITS>{0}.flip();
-        auto output_valid_bits = (all_one_bits << output_valid_bits_lenght).flip();
-        auto output_bits = item_bits & output_valid_bits;
-        auto output = BitBuffer::serialize_bitset(output_bits);
+        this->end_write();
+    }
 
-        if (output_valid_bits_lenght % BYTE_BITS) {
-            m_used_length_of_tail_byte = output_valid_bits_lenght % BYTE_BITS;
-        } else {
+    void BitBuffer::write_bytes(std::span<const u8> bytes) {
+        if (this->written_bits() % BYTE_BITS != 0) {
+            for (auto byte : bytes) {
+                this->write(byte);
+            }
+            return;
+        }
+
+        m_stats.count_write(bytes.size() * BYTE_BITS);
+        this->detach_mapped_file();
+        this->flush_pending_bits();
+
+        this->make_room(bytes.size());
+        m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+        if (!m_buffer.empty()) {
             m_used_length_of_tail_byte = BYTE_BITS;
         }
 
-        std::size_t output_valid_bytes_lenght =
-            BitBuffer::from_bits_to_bytes_length(output_valid_bits_lenght);
+        this->end_write();
+    }
 
-        assert(m_used_length_of_tail_byte <= BYTE_BITS);
-        assert(output_valid_bytes_lenght <= output.size());
+    template<typename T>
+    void BitBuffer::read_packed(std::span<T> values, std::size_t width) {
+        static_assert(std::is_integral_v<T>);
+        assert(width <= MAX_PACKED_WIDTH && width <= sizeof(T) * BYTE_BITS);
 
-        // Update the number of unread bits of the head byte
-        // if the buffer is empty
-        if (m_buffer.empty()) {
-            if (output_valid_bits_lenght < 8) {
-                m_unread_bits_of_head_byte = output_valid_bits_lenght;
-            } else {
-                m_unread_bits_of_head_byte = 8;
-            }
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto position = m_read_window.position();
+        assert(position + values.size() * width <= this->written_bits());
+        m_stats.count_read(values.size() * width);
+
+        if (width == 0) {
+            std::fill(values.begin(), values.end(), T(0));
+            return;
         }
 
-        m_buffer.insert(m_buffer.end(),
-                output.begin(), output.begin() + output_valid_bytes_lenght);
+        // The kernels load a whole word from the first byte of every value,
+        // the values too close to the end are left to the read window.
+        auto input = this->input();
+        std::size_t n_unpacked = 0;
+        if (input.size() >= sizeof(u64)) {
+            auto last_bit = (input.size() - sizeof(u64) + 1) * BYTE_BITS;
+            if (last_bit > position) {
+                n_unpacked = std::min(values.size(), (last_bit - position + width - 1) / width);
+            }
+        }
 
-        // Update m_buffer_slice for post read operations
-        if (m_buffer_slice.empty()) {
-            m_buffer_slice = IndexedSpan(0, m_buffer.size());
+        auto kernel = unpack_kernel(width);
+        if constexpr (sizeof(T) == sizeof(uint32_t)) {
+            kernel(input.data(), position, reinterpret_cast<uint32_t*>(values.data()), n_unpacked);
         } else {
-            assert(m_buffer_slice.offset() <= m_buffer.size());
-            auto new_slice_len = m_buffer.size() - m_buffer_slice.offset();
-            m_buffer_slice = IndexedSpan(0, new_slice_len);
+            const std::size_t block_length = 256;
+            auto block = std::array<uint32_t, block_length>();
+            for (std::size_t offset = 0; offset < n_unpacked; offset += block_length) {
+                auto n_block_values = std::min(block_length, n_unpacked - offset);
+                kernel(input.data(), position + offset * width, block.data(), n_block_values);
+                std::transform(block.begin(), block.begin() + n_block_values, values.begin() + offset,
+                    [](uint32_t value) {
+                        return static_cast<T>(value);
+                    });
+            }
+        }
+
+        m_read_window.seek(input, position + n_unpacked * width);
+        for (auto index = n_unpacked; index < values.size(); index++) {
+            values[index] = static_cast<T>(m_read_window.take_bits(input, width));
         }
     }
 
+    void BitBuffer::write_unary(u64 value) {
+        for (; value >= WORD_BITS; value -= WORD_BITS) {
+            this->write_bits<WORD_BITS>(u64(0));
+        }
+
+        this->write_bits(u64(1) << value, value + 1);
+    }
+
+    void BitBuffer::write_rice(u64 value, std::size_t k) {
+        assert(k < WORD_BITS);
+
+        auto quotient = value >> k;
+        auto remainder = value & low_bits_mask(k);
+        if (quotient + 1 + k <= WORD_BITS) {
+            this->write_bits((u64(1) << quotient) | (remainder << quotient << 1), quotient + 1 + k);
+            return;
+        }
+
+        this->write_unary(quotient);
+        this->write_bits(remainder, k);
+    }
+
+    void BitBuffer::write_exp_golomb(u64 value) {
+        assert(value < ~u64(0));
+
+        // The unary length of the suffix is followed by the bits of 'value + 1'
+        // below its leading one.
+        auto shifted = value + 1;
+        auto n_suffix_bits = static_cast<std::size_t>(std::bit_width(shifted)) - 1;
+        auto suffix = shifted & low_bits_mask(n_suffix_bits);
+        if (2 * n_suffix_bits + 1 <= WORD_BITS) {
+            auto code = (u64(1) << n_suffix_bits) | (suffix << (n_suffix_bits + 1));
+            this->write_bits(code, 2 * n_suffix_bits + 1);
+            return;
+        }
+
+        this->write_unary(n_suffix_bits);
+        this->write_bits(suffix, n_suffix_bits);
+    }
+
+    void BitBuffer::write_leb128(u64 value) {
+        this->write_bits(u8(0), (BYTE_BITS - this->written_bits() % BYTE_BITS) % BYTE_BITS);
+
+        const u64 group_mask = 0x7f;
+        const u64 continuation_bit = 0x80;
+        while (value > group_mask) {
+            this->write_bits<BYTE_BITS>((value & group_mask) | continuation_bit);
+            value >>= 7;
+        }
+
+        this->write_bits<BYTE_BITS>(value);
+    }
+
+    void BitBuffer::write_zigzag(int64_t value) {
+        this->write_leb128(zigzag_encode(value));
+    }
+
+    u64 BitBuffer::read_unary() {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto start = m_read_window.position();
+        auto value = m_read_window.take_unary(this->input());
+
+        // The bits being read must have been written
+        assert(m_read_window.position() <= this->written_bits());
+        m_stats.count_read(m_read_window.position() - start);
+
+        return value;
+    }
+
+    u64 BitBuffer::read_rice(std::size_t k) {
+        assert(k < WORD_BITS);
+
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto input = this->input();
+        auto start = m_read_window.position();
+        auto quotient = m_read_window.take_unary(input);
+        auto remainder = m_read_window.read_bits_as<u64>(input, k);
+
+        // The bits being read must have been written
+        assert(m_read_window.position() <= this->written_bits());
+        m_stats.count_read(m_read_window.position() - start);
+
+        return (quotient << k) | remainder;
+    }
+
+    u64 BitBuffer::read_exp_golomb() {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto input = this->input();
+        auto start = m_read_window.position();
+        auto n_suffix_bits = m_read_window.take_unary(input);
+        assert(n_suffix_bits < WORD_BITS);
+
+        auto suffix = m_read_window.read_bits_as<u64>(input, n_suffix_bits);
+
+        // The bits being read must have been written
+        assert(m_read_window.position() <= this->written_bits());
+        m_stats.count_read(m_read_window.position() - start);
+
+        return ((u64(1) << n_suffix_bits) | suffix) - 1;
+    }
+
+    u64 BitBuffer::read_leb128() {
+        this->flush_pending_bits();
+        this->sync_read_window();
+
+        auto input = this->input();
+        auto start = m_read_window.position();
+        auto n_padding_bits = (BYTE_BITS - m_read_window.position() % BYTE_BITS) % BYTE_BITS;
+        m_read_window.take_bits(input, n_padding_bits);
+
+        u64 value = 0;
+        for (std::size_t shift = 0; shift < WORD_BITS; shift += 7) {
+            auto byte = m_read_window.take_bits<BYTE_BITS>(input);
+            value |= (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        // The bits being read must have been written
+        assert(m_read_window.position() <= this->written_bits());
+        m_stats.count_read(m_read_window.position() - start);
+
+        return value;
+    }
+
+    int64_t BitBuffer::read_zigzag() {
+        return zigzag_decode(this->read_leb128());
+    }
+
     template<typename T>
     void BitBuffer::read_from_vector(std::vector<T>& slice) {
         auto span = std::span<T>(slice.data(), slice.size());
@@ -288,21 +894,16 @@ namespace outbit {
     template<typename T>
     void BitBuffer::read_from_span(std::span<T> slice) {
         auto slice_as_bytes = std::as_bytes(slice);
-        m_buffer = std::vector<u8>();
+        auto* first_byte = reinterpret_cast<const u8*>(slice_as_bytes.data());
+        m_buffer.assign(first_byte, first_byte + slice_as_bytes.size());
+        m_mapped_file.reset();
+        m_accumulator.clear();
 
-        // Use std::transform to convert std::byte to u8 (or unsigned char)
-        std::transform(slice_as_bytes.begin(), slice_as_bytes.end(), std::back_inserter(m_buffer),
-            [](std::byte b) {
-                return static_cast<u8>(b);
-            });
+        m_read_window.rewind();
+        m_reload_position.reset();
+        m_dropped_bytes = 0;
 
-        // m_buffer_slice = std::span<u8>(m_buffer);
-        m_buffer_slice = IndexedSpan(0, m_buffer.size());
-        
-        if (!m_buffer.empty()) {
-            m_unread_bits_of_head_byte = BYTE_BITS;
-            m_used_length_of_tail_byte = BYTE_BITS;
-        }
+        m_used_length_of_tail_byte = m_buffer.empty() ? 0 : BYTE_BITS;
     }
 
     constexpr
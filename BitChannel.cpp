@@ -0,0 +1,90 @@
+#include "BitChannel.hpp"
+#include <print>
+#include <stdexcept>
+
+namespace outbit {
+    BitChannel::BitChannel(std::size_t capacity_in_bytes) {
+        auto n_words = std::bit_ceil(std::max<std::size_t>((capacity_in_bytes + sizeof(u64) - 1) / sizeof(u64), MIN_WORDS));
+        m_words = std::make_unique<std::atomic<u64>[]>(n_words);
+        m_mask = n_words - 1;
+    }
+
+    void BitChannel::flush() {
+        assert(!m_closed);
+
+        // The word is stored again once complete, with the same low bits.
+        // Its slot is free, as every bit of the accumulator had room.
+        if (m_accumulator.size() > 0) {
+            m_words[m_written_words & m_mask].store(m_accumulator.bits(), std::memory_order_relaxed);
+        }
+
+        // Wakes the consumer up even without new bits, as the words
+        // published before may not have reached the wake-up threshold.
+        this->publish(m_written_words * WORD_BITS + m_accumulator.size(), true);
+    }
+
+    void BitChannel::close() {
+        this->flush();
+        m_closed = true;
+
+        this->publish((m_written_words * WORD_BITS + m_accumulator.size()) | CLOSED_FLAG, true);
+    }
+
+    void BitChannel::wait_for_room(std::size_t n_bits) {
+        // The consumer may be waiting for the bits of the accumulator, or
+        // for published words below the wake-up threshold, which a small
+        // ring never reaches before it is full.
+        this->flush();
+
+        while (true) {
+            m_producer_sleeping.store(true);
+            if (this->has_room(n_bits)) {
+                m_producer_sleeping.store(false);
+                return;
+            }
+
+            m_consumed.wait(m_known_consumed);
+        }
+    }
+
+    void BitChannel::wait_for_bits(std::size_t n_bits, const std::source_location caller_location,
+            const std::source_location callee_location) {
+        while (true) {
+            m_consumer_sleeping.store(true);
+            auto published = m_published.load();
+            m_known_published = published & ~CLOSED_FLAG;
+            if (m_known_published - m_read_position >= n_bits) {
+                m_consumer_sleeping.store(false);
+                return;
+            }
+
+            if (published & CLOSED_FLAG) {
+                m_consumer_sleeping.store(false);
+
+                auto erro_msg =
+                    std::format(
+                            "[{}:{}] Method '{}' failed to read {} bits. The channel was closed with {} bits left.",
+                            caller_location.file_name(),
+                            caller_location.line(),
+                            callee_location.function_name(),
+                            n_bits,
+                            m_known_published - m_read_position);
+
+                throw std::runtime_error(erro_msg);
+            }
+
+            m_published.wait(published);
+        }
+    }
+
+    std::size_t BitChannel::readable_bits() {
+        m_known_published = m_published.load(std::memory_order_acquire) & ~CLOSED_FLAG;
+        return m_known_published - m_read_position;
+    }
+
+    bool BitChannel::at_end() {
+        auto published = m_published.load(std::memory_order_acquire);
+        m_known_published = published & ~CLOSED_FLAG;
+        return (published & CLOSED_FLAG) && m_read_position == m_known_published;
+    }
+}
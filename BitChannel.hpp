@@ -0,0 +1,235 @@
+#pragma once
+
+#include "BitEngine.hpp"
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <source_location>
+
+namespace outbit {
+    // Streams bits from one producer thread to one consumer thread, without
+    // locks. The bits go through a bounded ring of 64-bit words:
+    //
+    //  - the producer stages bits as a BitWriter does and publishes every
+    //    word it completes, or its unfinished word on 'flush';
+    //  - the consumer reads any published bits, and releases the words it
+    //    is done with to the producer.
+    //
+    // Each side owns its half of the state and only shares the two cursors,
+    // on cache lines of their own. Cursors are counted in bits from the
+    // start of the stream. A side with nothing to do sleeps on the cursor
+    // of the other side, and is woken once half of the ring is ready for it.
+    // A consumer waiting on a producer that stops writing is only woken by
+    // 'flush' or 'close', which the producer also calls before it waits
+    // for room.
+    //
+    // Only integral and enum items are supported, of at most 64 bits.
+    class BitChannel {
+        public:
+            static constexpr std::size_t DEFAULT_CAPACITY = std::size_t(64) * 1024;
+
+            // A read may stay in the middle of a word while it waits for an
+            // item of 64 bits, which the producer must have room for.
+            static constexpr std::size_t MIN_WORDS = 4;
+
+            // The capacity is rounded up to a power of two words, of at least 'MIN_WORDS'.
+            explicit BitChannel(std::size_t capacity_in_bytes = DEFAULT_CAPACITY);
+            BitChannel(const BitChannel&) = delete;
+            BitChannel& operator=(const BitChannel&) = delete;
+
+            // Producer side. 'write' and 'write_bits' wait for room in the
+            // ring, the 'try_' versions write nothing and return false when
+            // there is none.
+            template<typename T>
+            void write(const T& item);
+            template<typename T>
+            void write_bits(const T& item, std::size_t n_bits);
+            template<typename T>
+            bool try_write_bits(const T& item, std::size_t n_bits);
+            // Publishes the bits of the unfinished word, and wakes a waiting
+            // consumer up.
+            void flush();
+            // Flushes and ends the stream. Nothing can be written afterwards.
+            void close();
+
+            // Consumer side. 'read_as' and 'read_bits_as' wait until the
+            // bits are published, and throw if the stream ends before.
+            template<typename T>
+            T read_as(std::source_location = std::source_location::current());
+            template<typename T>
+            T read_bits_as(std::size_t n_bits, std::source_location = std::source_location::current());
+            template<typename T>
+            std::optional<T> try_read_bits_as(std::size_t n_bits);
+            // Bits published and not read yet.
+            std::size_t readable_bits();
+            // Whether the stream was closed and every bit of it was read.
+            bool at_end();
+
+            std::size_t capacity_in_bits() const { return (m_mask + 1) * WORD_BITS; }
+
+        private:
+            static constexpr std::size_t CACHE_LINE_SIZE = 64;
+            // Set in the published cursor once the stream is closed, so that
+            // a waiting consumer sees the cursor change.
+            static constexpr u64 CLOSED_FLAG = u64(1) << 63;
+
+            // Producer side.
+            inline bool has_room(std::size_t n_bits);
+            void wait_for_room(std::size_t n_bits);
+            inline void store_word(u64 word);
+            inline void publish(u64 cursor, bool wake_up);
+
+            // Consumer side.
+            inline bool has_bits(std::size_t n_bits);
+            void wait_for_bits(std::size_t n_bits, std::source_location caller_location,
+                    std::source_location callee_location);
+            inline u64 take_bits(std::size_t n_bits);
+
+            std::unique_ptr<std::atomic<u64>[]> m_words;
+            std::size_t m_mask;
+
+            // Bits published by the producer, and 'CLOSED_FLAG'.
+            alignas(CACHE_LINE_SIZE) std::atomic<u64> m_published{0};
+            // Set by the consumer before it sleeps on 'm_published', and
+            // cleared by the producer when it wakes it up, so that it is only
+            // notified once.
+            std::atomic<bool> m_consumer_sleeping{false};
+            // Bits read by the consumer. Only whole words are released, so it
+            // is updated when a read crosses a word boundary.
+            alignas(CACHE_LINE_SIZE) std::atomic<u64> m_consumed{0};
+            std::atomic<bool> m_producer_sleeping{false};
+
+            alignas(CACHE_LINE_SIZE) BitAccumulator m_accumulator;
+            u64 m_written_words = 0;
+            // Last value of 'm_consumed' seen by the producer.
+            u64 m_known_consumed = 0;
+            bool m_closed = false;
+
+            alignas(CACHE_LINE_SIZE) u64 m_read_position = 0;
+            // Last value of 'm_published' seen by the consumer.
+            u64 m_known_published = 0;
+    };
+
+    // Whether 'n_bits' more fit in the words released by the consumer.
+    bool BitChannel::has_room(std::size_t n_bits) {
+        auto end = m_written_words * WORD_BITS + m_accumulator.size() + n_bits;
+        if (end <= m_known_consumed / WORD_BITS * WORD_BITS + this->capacity_in_bits()) {
+            return true;
+        }
+
+        m_known_consumed = m_consumed.load();
+        return end <= m_known_consumed / WORD_BITS * WORD_BITS + this->capacity_in_bits();
+    }
+
+    void BitChannel::store_word(u64 word) {
+        m_words[m_written_words & m_mask].store(word, std::memory_order_relaxed);
+        m_written_words++;
+        this->publish(m_written_words * WORD_BITS, false);
+    }
+
+    // Sequentially consistent, as is the flag set by a sleeping consumer:
+    // either the consumer sees the new cursor or the producer sees the flag.
+    // The consumer is woken once half of the ring is filled, so that the
+    // two threads do not take turns at every word on a busy CPU.
+    void BitChannel::publish(u64 cursor, bool wake_up) {
+        m_published.store(cursor);
+        if (m_consumer_sleeping.load()
+                && (wake_up || (cursor & ~CLOSED_FLAG) - m_known_consumed >= this->capacity_in_bits() / 2)) {
+            m_consumer_sleeping.store(false);
+            m_published.notify_one();
+        }
+    }
+
+    bool BitChannel::has_bits(std::size_t n_bits) {
+        if (m_known_published - m_read_position >= n_bits) {
+            return true;
+        }
+
+        m_known_published = m_published.load() & ~CLOSED_FLAG;
+        return m_known_published - m_read_position >= n_bits;
+    }
+
+    // The bits must be published. The words are only released once every
+    // bit of them was read.
+    u64 BitChannel::take_bits(std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS && m_read_position + n_bits <= m_known_published);
+
+        auto index = m_read_position / WORD_BITS;
+        auto offset = m_read_position % WORD_BITS;
+        auto bits = m_words[index & m_mask].load(std::memory_order_relaxed) >> offset;
+        if (offset + n_bits > WORD_BITS) {
+            bits |= m_words[(index + 1) & m_mask].load(std::memory_order_relaxed) << (WORD_BITS - offset);
+        }
+
+        m_read_position += n_bits;
+        if (m_read_position / WORD_BITS != index) {
+            m_consumed.store(m_read_position);
+            if (m_producer_sleeping.load() && m_known_published - m_read_position <= this->capacity_in_bits() / 2) {
+                m_producer_sleeping.store(false);
+                m_consumed.notify_one();
+            }
+        }
+
+        return bits & low_bits_mask(n_bits);
+    }
+
+    template<typename T>
+    void BitChannel::write(const T& item) {
+        this->write_bits(item, sizeof(T) * BYTE_BITS);
+    }
+
+    template<typename T>
+    void BitChannel::write_bits(const T& item, std::size_t n_bits) {
+        if (!this->has_room(n_bits)) {
+            this->wait_for_room(n_bits);
+        }
+
+        [[maybe_unused]] auto written = this->try_write_bits(item, n_bits);
+        assert(written);
+    }
+
+    template<typename T>
+    bool BitChannel::try_write_bits(const T& item, std::size_t n_bits) {
+        static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "Only integral and enum items are supported.");
+        assert(!m_closed);
+
+        if (!this->has_room(n_bits)) {
+            return false;
+        }
+
+        m_accumulator.push_item(item, n_bits, [this](u64 word) {
+            this->store_word(word);
+        });
+
+        return true;
+    }
+
+    template<typename T>
+    T BitChannel::read_as(const std::source_location caller_location) {
+        return this->read_bits_as<T>(sizeof(T) * BYTE_BITS, caller_location);
+    }
+
+    template<typename T>
+    T BitChannel::read_bits_as(std::size_t n_bits, const std::source_location caller_location) {
+        static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "Only integral and enum items are supported.");
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+
+        if (!this->has_bits(n_bits)) {
+            this->wait_for_bits(n_bits, caller_location, std::source_location::current());
+        }
+
+        return static_cast<T>(this->take_bits(n_bits));
+    }
+
+    template<typename T>
+    std::optional<T> BitChannel::try_read_bits_as(std::size_t n_bits) {
+        static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "Only integral and enum items are supported.");
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+
+        if (!this->has_bits(n_bits)) {
+            return std::nullopt;
+        }
+
+        return static_cast<T>(this->take_bits(n_bits));
+    }
+}
@@ -0,0 +1,703 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <span>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <type_traits>
+
+// Bit engines shared by every reader and writer of the library.
+namespace outbit {
+    const int BYTE_BITS = 8;
+
+    using u8 = uint8_t;
+    using s8 = int8_t;
+    using u64 = uint64_t;
+
+    const std::size_t WORD_BITS = sizeof(u64) * BYTE_BITS;
+
+    constexpr u64 low_bits_mask(std::size_t n_bits) {
+        return n_bits >= WORD_BITS ? ~u64(0) : (u64(1) << n_bits) - 1;
+    }
+
+    // Maps signed values to unsigned ones so that small magnitudes, of
+    // either sign, get small codes: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+    constexpr u64 zigzag_encode(int64_t value) {
+        return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63);
+    }
+
+    constexpr int64_t zigzag_decode(u64 value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Same as 'std::memcpy', which constant expressions cannot call.
+    constexpr void copy_bytes(u8* destination, const u8* source, std::size_t n_bytes) {
+        if consteval {
+            std::copy_n(source, n_bytes, destination);
+        } else {
+            std::memcpy(destination, source, n_bytes);
+        }
+    }
+
+    // Loads up to 8 bytes as a little-endian word, regardless of the host order.
+    constexpr u64 load_word(const u8* bytes, std::size_t n_bytes) {
+        assert(n_bytes <= sizeof(u64));
+
+        auto word_bytes = std::array<u8, sizeof(u64)>();
+        copy_bytes(word_bytes.data(), bytes, n_bytes);
+
+        auto word = std::bit_cast<u64>(word_bytes);
+        if constexpr (std::endian::native == std::endian::big) {
+            word = std::byteswap(word);
+        }
+
+        return word;
+    }
+
+    // Stores a word as 8 little-endian bytes, regardless of the host order.
+    constexpr std::array<u8, sizeof(u64)> store_word(u64 word) {
+        if constexpr (std::endian::native == std::endian::big) {
+            word = std::byteswap(word);
+        }
+
+        return std::bit_cast<std::array<u8, sizeof(u64)>>(word);
+    }
+
+    // Same as 'load_word', with the first byte in the high bits of the word.
+    constexpr u64 load_big_endian_word(const u8* bytes, std::size_t n_bytes) {
+        assert(n_bytes <= sizeof(u64));
+
+        auto word_bytes = std::array<u8, sizeof(u64)>();
+        copy_bytes(word_bytes.data(), bytes, n_bytes);
+
+        auto word = std::bit_cast<u64>(word_bytes);
+        if constexpr (std::endian::native == std::endian::little) {
+            word = std::byteswap(word);
+        }
+
+        return word;
+    }
+
+    constexpr std::array<u8, sizeof(u64)> store_big_endian_word(u64 word) {
+        if constexpr (std::endian::native == std::endian::little) {
+            word = std::byteswap(word);
+        }
+
+        return std::bit_cast<std::array<u8, sizeof(u64)>>(word);
+    }
+
+    // Order in which the bits of a stream fill its bytes.
+    enum class BitOrder {
+        // Bit 0 of the stream is the low bit of byte 0 and values start
+        // with their low bits, as in DEFLATE. Words are little-endian.
+        lsb_first,
+        // Bit 0 of the stream is the high bit of byte 0 and values start
+        // with their high bits, as in JPEG or H.264. Words are big-endian.
+        msb_first,
+    };
+
+    // Write engine shared by the bit writers. It stages bits LSB-first in a
+    // 64-bit register and hands every completed word to a 'spill' callback,
+    // which receives it in host order (see 'store_word').
+    class BitAccumulator {
+        public:
+            // Number of bits currently staged, always below 64.
+            constexpr std::size_t size() const { return m_count; }
+            constexpr u64 bits() const { return m_bits; }
+            constexpr void clear();
+            constexpr void drop(std::size_t n_bits);
+
+            template<typename Spill>
+            constexpr void push(u64 bits, std::size_t n_bits, Spill&& spill);
+            template<typename T, typename Spill>
+            constexpr void push_item(const T& item, std::size_t n_bits, Spill&& spill);
+            // Same as above, with the width known at compile time.
+            template<std::size_t N, typename T, typename Spill>
+            constexpr void push_item(const T& item, Spill&& spill);
+
+        private:
+            template<typename T>
+            static constexpr u64 to_word(const T& item);
+
+            u64 m_bits = 0;
+            std::size_t m_count = 0;
+    };
+
+    constexpr void BitAccumulator::clear() {
+        m_bits = 0;
+        m_count = 0;
+    }
+
+    // Discards the 'n_bits' oldest staged bits.
+    constexpr void BitAccumulator::drop(std::size_t n_bits) {
+        assert(n_bits <= m_count);
+
+        m_bits = n_bits < WORD_BITS ? m_bits >> n_bits : 0;
+        m_count -= n_bits;
+    }
+
+    // Appends the 'n_bits' low bits of 'bits'. Bits above 'n_bits' must be zero.
+    template<typename Spill>
+    constexpr void BitAccumulator::push(u64 bits, std::size_t n_bits, Spill&& spill) {
+        assert(n_bits <= WORD_BITS);
+
+        m_bits |= bits << m_count;
+
+        auto count = m_count + n_bits;
+        if (count < WORD_BITS) {
+            m_count = count;
+            return;
+        }
+
+        spill(m_bits);
+
+        // Keep the bits of 'bits' that did not fit in the spilled word.
+        m_bits = m_count > 0 ? bits >> (WORD_BITS - m_count) : 0;
+        m_count = count - WORD_BITS;
+    }
+
+    // Appends the 'n_bits' low bits of the object representation of 'item'.
+    template<typename T, typename Spill>
+    constexpr void BitAccumulator::push_item(const T& item, std::size_t n_bits, Spill&& spill) {
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+
+        if constexpr (sizeof(T) <= sizeof(u64)) {
+            this->push(BitAccumulator::to_word(item) & low_bits_mask(n_bits), n_bits, spill);
+        } else {
+            // Items wider than the register are pushed one word at a time.
+            auto item_bytes = std::bit_cast<std::array<u8, sizeof(T)>>(item);
+            for (std::size_t offset = 0; offset < n_bits; offset += WORD_BITS) {
+                auto chunk_bits = std::min(WORD_BITS, n_bits - offset);
+                auto byte_offset = offset / BYTE_BITS;
+                auto chunk_bytes = std::min(sizeof(u64), item_bytes.size() - byte_offset);
+                auto word = load_word(item_bytes.data() + byte_offset, chunk_bytes);
+
+                this->push(word & low_bits_mask(chunk_bits), chunk_bits, spill);
+            }
+        }
+    }
+
+    template<std::size_t N, typename T, typename Spill>
+    constexpr void BitAccumulator::push_item(const T& item, Spill&& spill) {
+        static_assert(N <= sizeof(T) * BYTE_BITS, "Width 'N' is larger than the item.");
+
+        if constexpr (N == 0) {
+            return;
+        } else if constexpr (sizeof(T) <= sizeof(u64)) {
+            constexpr auto mask = low_bits_mask(N);
+            this->push(BitAccumulator::to_word(item) & mask, N, spill);
+        } else {
+            this->push_item(item, N, spill);
+        }
+    }
+
+    template<typename T>
+    constexpr u64 BitAccumulator::to_word(const T& item) {
+        static_assert(sizeof(T) <= sizeof(u64));
+
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            return static_cast<u64>(item);
+        } else {
+            auto item_bytes = std::bit_cast<std::array<u8, sizeof(T)>>(item);
+            return load_word(item_bytes.data(), item_bytes.size());
+        }
+    }
+
+    // Read engine shared by the bit readers. It keeps the next unread bits
+    // of a byte sequence, LSB-first, in a 64-bit register. The bytes are
+    // passed to every call, so their owner may reallocate them between reads.
+    class BitWindow {
+        public:
+            constexpr std::size_t position() const;
+            constexpr void rewind();
+            constexpr void seek(std::span<const u8> input, std::size_t position);
+            constexpr void refill(std::span<const u8> input);
+            constexpr u64 take_bits(std::span<const u8> input, std::size_t n_bits);
+            template<std::size_t N>
+            constexpr u64 take_bits(std::span<const u8> input);
+            // Returns the next 'n_bits' (at most 56) without consuming them.
+            // Bits past the end of the input read as zeros.
+            constexpr u64 peek_bits(std::span<const u8> input, std::size_t n_bits);
+            // Consumes 'n_bits' that were returned by 'peek_bits'.
+            constexpr void consume_bits(std::size_t n_bits);
+            // Consumes zeros up to and including the next one, and returns
+            // the number of zeros.
+            constexpr u64 take_unary(std::span<const u8> input);
+            template<typename T>
+            constexpr T read_bits_as(std::span<const u8> input, std::size_t n_bits);
+            // Same as above, for inputs that change while reading. 'input' is
+            // called with the number of bits about to be taken and returns the
+            // bytes to refill from.
+            template<typename T, typename Input>
+            constexpr T read_bits_as(std::size_t n_bits, Input&& input);
+            // Same as 'read_bits_as', with the width known at compile time.
+            template<std::size_t N, typename T>
+            constexpr T read_bits(std::span<const u8> input);
+
+            // Bits loaded and not consumed yet.
+            constexpr std::size_t window_bits() const { return m_window_bits; }
+            // The loaded bits, LSB-first. The bits above 'window_bits' are
+            // zeros or the bits that follow in the input.
+            constexpr u64 bits() const { return m_window; }
+            // Index of the first byte of the input not loaded yet.
+            constexpr std::size_t next_byte() const { return m_offset; }
+            // Tells the window its unloaded bytes were moved to 'next_byte'.
+            constexpr void move_input(std::size_t next_byte) { m_offset = next_byte; }
+
+        private:
+            template<typename T>
+            static constexpr T from_word(u64 word);
+
+            u64 m_window = 0;
+            std::size_t m_window_bits = 0;
+            // Index of the first byte not yet loaded into 'm_window'.
+            std::size_t m_offset = 0;
+    };
+
+    // Number of bits consumed so far.
+    constexpr std::size_t BitWindow::position() const {
+        return m_offset * BYTE_BITS - m_window_bits;
+    }
+
+    constexpr void BitWindow::rewind() {
+        m_window = 0;
+        m_window_bits = 0;
+        m_offset = 0;
+    }
+
+    // Moves the window so the next bit taken is bit 'position' of 'input'.
+    constexpr void BitWindow::seek(std::span<const u8> input, std::size_t position) {
+        this->rewind();
+        m_offset = position / BYTE_BITS;
+
+        auto n_read_bits = position % BYTE_BITS;
+        if (n_read_bits > 0) {
+            m_window = u64(input[m_offset]) >> n_read_bits;
+            m_window_bits = BYTE_BITS - n_read_bits;
+            m_offset++;
+        }
+    }
+
+    // Tops the window up to at least 56 bits, or to the end of 'input'.
+    constexpr void BitWindow::refill(std::span<const u8> input) {
+        if (m_offset + sizeof(u64) <= input.size()) {
+            // Load a whole word and keep the bytes that fit. The bytes that do
+            // not fit land above 'm_window_bits' and are loaded again, with the
+            // same value and at the same position, by the next refill.
+            auto word = load_word(input.data() + m_offset, sizeof(u64));
+            m_window |= word << m_window_bits;
+
+            auto n_bytes = (WORD_BITS - 1 - m_window_bits) / BYTE_BITS;
+            m_offset += n_bytes;
+            m_window_bits += n_bytes * BYTE_BITS;
+            return;
+        }
+
+        while (m_window_bits <= WORD_BITS - BYTE_BITS && m_offset < input.size()) {
+            m_window |= u64(input[m_offset]) << m_window_bits;
+            m_offset++;
+            m_window_bits += BYTE_BITS;
+        }
+    }
+
+    // Consumes 'n_bits' (at most 56) from the window.
+    constexpr u64 BitWindow::take_bits(std::span<const u8> input, std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS - BYTE_BITS);
+
+        if (m_window_bits < n_bits) {
+            this->refill(input);
+            assert(m_window_bits >= n_bits);
+        }
+
+        auto bits = m_window & low_bits_mask(n_bits);
+        m_window >>= n_bits;
+        m_window_bits -= n_bits;
+        return bits;
+    }
+
+    template<std::size_t N>
+    constexpr u64 BitWindow::take_bits(std::span<const u8> input) {
+        static_assert(N <= WORD_BITS - BYTE_BITS);
+
+        if (m_window_bits < N) {
+            this->refill(input);
+            assert(m_window_bits >= N);
+        }
+
+        constexpr auto mask = low_bits_mask(N);
+        auto bits = m_window & mask;
+        m_window >>= N;
+        m_window_bits -= N;
+        return bits;
+    }
+
+    constexpr u64 BitWindow::peek_bits(std::span<const u8> input, std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS - BYTE_BITS);
+
+        if (m_window_bits < n_bits) {
+            this->refill(input);
+        }
+
+        return m_window & low_bits_mask(std::min(n_bits, m_window_bits));
+    }
+
+    constexpr void BitWindow::consume_bits(std::size_t n_bits) {
+        assert(n_bits <= m_window_bits && n_bits <= WORD_BITS - BYTE_BITS);
+
+        m_window >>= n_bits;
+        m_window_bits -= n_bits;
+    }
+
+    constexpr u64 BitWindow::take_unary(std::span<const u8> input) {
+        u64 n_zeros = 0;
+        while (true) {
+            if (m_window_bits == 0) {
+                this->refill(input);
+                assert(m_window_bits > 0);
+                if (m_window_bits == 0) {
+                    return n_zeros;
+                }
+            }
+
+            // The stream is LSB-first, so the next bits are the low ones.
+            auto window = m_window & low_bits_mask(m_window_bits);
+            if (window != 0) {
+                auto n_window_zeros = static_cast<std::size_t>(std::countr_zero(window));
+                // Two shifts, as the one may be the 64th bit of the window.
+                m_window = (m_window >> n_window_zeros) >> 1;
+                m_window_bits -= n_window_zeros + 1;
+                return n_zeros + n_window_zeros;
+            }
+
+            n_zeros += m_window_bits;
+            m_window = 0;
+            m_window_bits = 0;
+        }
+    }
+
+    template<typename T>
+    constexpr T BitWindow::read_bits_as(std::span<const u8> input, std::size_t n_bits) {
+        return this->read_bits_as<T>(n_bits, [input](std::size_t) { return input; });
+    }
+
+    template<typename T, typename Input>
+    constexpr T BitWindow::read_bits_as(std::size_t n_bits, Input&& input) {
+        if constexpr (sizeof(T) <= sizeof(u64)) {
+            if (n_bits <= WORD_BITS - BYTE_BITS) {
+                return BitWindow::from_word<T>(this->take_bits(input(n_bits), n_bits));
+            }
+        }
+
+        // Wide items are assembled 32 bits at a time. The bits of the
+        // item above 'n_bits' are left zeroed.
+        const std::size_t chunk_bits_length = 32;
+        auto item_bytes = std::array<u8, sizeof(T)>();
+        for (std::size_t offset = 0; offset < n_bits; offset += chunk_bits_length) {
+            auto chunk_bits = std::min(chunk_bits_length, n_bits - offset);
+            auto chunk = static_cast<uint32_t>(this->take_bits(input(chunk_bits), chunk_bits));
+            if constexpr (std::endian::native == std::endian::big) {
+                chunk = std::byteswap(chunk);
+            }
+
+            auto byte_offset = offset / BYTE_BITS;
+            auto chunk_bytes = std::min(sizeof(chunk), sizeof(T) - byte_offset);
+            copy_bytes(item_bytes.data() + byte_offset, std::bit_cast<std::array<u8, sizeof(chunk)>>(chunk).data(), chunk_bytes);
+        }
+
+        return std::bit_cast<T>(item_bytes);
+    }
+
+    template<std::size_t N, typename T>
+    constexpr T BitWindow::read_bits(std::span<const u8> input) {
+        static_assert(N <= sizeof(T) * BYTE_BITS, "Width 'N' is larger than the item.");
+
+        if constexpr (sizeof(T) <= sizeof(u64) && N <= WORD_BITS - BYTE_BITS) {
+            return BitWindow::from_word<T>(this->take_bits<N>(input));
+        } else if constexpr (sizeof(T) <= sizeof(u64)) {
+            // Two halves, as a refill only guarantees 56 bits.
+            const std::size_t half_bits = 32;
+            auto low = this->take_bits<half_bits>(input);
+            auto high = this->take_bits<N - half_bits>(input);
+            return BitWindow::from_word<T>(low | (high << half_bits));
+        } else {
+            return this->read_bits_as<T>(input, N);
+        }
+    }
+
+    template<typename T>
+    constexpr T BitWindow::from_word(u64 word) {
+        static_assert(sizeof(T) <= sizeof(u64));
+
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            return static_cast<T>(word);
+        } else {
+            if constexpr (std::endian::native == std::endian::big) {
+                word = std::byteswap(word);
+            }
+
+            auto word_bytes = std::bit_cast<std::array<u8, sizeof(u64)>>(word);
+            auto item_bytes = std::array<u8, sizeof(T)>();
+            copy_bytes(item_bytes.data(), word_bytes.data(), sizeof(T));
+            return std::bit_cast<T>(item_bytes);
+        }
+    }
+
+    // MSB-first counterpart of BitAccumulator. The staged bits are kept in
+    // the high bits of the register, so a spilled word is stored big-endian.
+    // Only integral and enum items up to 64 bits can be pushed.
+    class MsbBitAccumulator {
+        public:
+            constexpr std::size_t size() const { return m_count; }
+            // The staged bits, from the highest bit down.
+            constexpr u64 bits() const { return m_bits; }
+            constexpr void clear();
+            constexpr void drop(std::size_t n_bits);
+
+            template<typename Spill>
+            constexpr void push(u64 bits, std::size_t n_bits, Spill&& spill);
+            template<typename T, typename Spill>
+            constexpr void push_item(const T& item, std::size_t n_bits, Spill&& spill);
+            template<std::size_t N, typename T, typename Spill>
+            constexpr void push_item(const T& item, Spill&& spill);
+
+        private:
+            u64 m_bits = 0;
+            std::size_t m_count = 0;
+    };
+
+    constexpr void MsbBitAccumulator::clear() {
+        m_bits = 0;
+        m_count = 0;
+    }
+
+    constexpr void MsbBitAccumulator::drop(std::size_t n_bits) {
+        assert(n_bits <= m_count);
+
+        m_bits = n_bits < WORD_BITS ? m_bits << n_bits : 0;
+        m_count -= n_bits;
+    }
+
+    // Appends the 'n_bits' low bits of 'bits', highest first. Bits above
+    // 'n_bits' must be zero.
+    template<typename Spill>
+    constexpr void MsbBitAccumulator::push(u64 bits, std::size_t n_bits, Spill&& spill) {
+        assert(n_bits <= WORD_BITS);
+
+        if (n_bits == 0) {
+            return;
+        }
+
+        auto count = m_count + n_bits;
+        if (count < WORD_BITS) {
+            m_bits |= bits << (WORD_BITS - count);
+            m_count = count;
+            return;
+        }
+
+        // The low 'n_overflow_bits' of 'bits' start the next word.
+        auto n_overflow_bits = count - WORD_BITS;
+        m_bits |= bits >> n_overflow_bits;
+        spill(m_bits);
+
+        m_bits = n_overflow_bits > 0 ? bits << (WORD_BITS - n_overflow_bits) : 0;
+        m_count = n_overflow_bits;
+    }
+
+    template<typename T, typename Spill>
+    constexpr void MsbBitAccumulator::push_item(const T& item, std::size_t n_bits, Spill&& spill) {
+        static_assert((std::is_integral_v<T> || std::is_enum_v<T>) && sizeof(T) <= sizeof(u64),
+                "MSB-first streams only hold integral and enum items.");
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+
+        this->push(static_cast<u64>(item) & low_bits_mask(n_bits), n_bits, spill);
+    }
+
+    template<std::size_t N, typename T, typename Spill>
+    constexpr void MsbBitAccumulator::push_item(const T& item, Spill&& spill) {
+        static_assert(N <= sizeof(T) * BYTE_BITS, "Width 'N' is larger than the item.");
+
+        this->push_item(item, N, spill);
+    }
+
+    // MSB-first counterpart of BitWindow. The next unread bit is the
+    // highest bit of the register, and the bits below 'window_bits' are
+    // zeros or the bits that follow in the input.
+    class MsbBitWindow {
+        public:
+            constexpr std::size_t position() const;
+            constexpr void rewind();
+            constexpr void seek(std::span<const u8> input, std::size_t position);
+            constexpr void refill(std::span<const u8> input);
+            constexpr u64 take_bits(std::span<const u8> input, std::size_t n_bits);
+            template<std::size_t N>
+            constexpr u64 take_bits(std::span<const u8> input);
+            constexpr u64 peek_bits(std::span<const u8> input, std::size_t n_bits);
+            constexpr void consume_bits(std::size_t n_bits);
+            template<typename T>
+            constexpr T read_bits_as(std::span<const u8> input, std::size_t n_bits);
+            template<std::size_t N, typename T>
+            constexpr T read_bits(std::span<const u8> input);
+
+            constexpr std::size_t window_bits() const { return m_window_bits; }
+            constexpr u64 bits() const { return m_window; }
+            constexpr std::size_t next_byte() const { return m_offset; }
+
+        private:
+            u64 m_window = 0;
+            std::size_t m_window_bits = 0;
+            std::size_t m_offset = 0;
+    };
+
+    constexpr std::size_t MsbBitWindow::position() const {
+        return m_offset * BYTE_BITS - m_window_bits;
+    }
+
+    constexpr void MsbBitWindow::rewind() {
+        m_window = 0;
+        m_window_bits = 0;
+        m_offset = 0;
+    }
+
+    constexpr void MsbBitWindow::seek(std::span<const u8> input, std::size_t position) {
+        this->rewind();
+        m_offset = position / BYTE_BITS;
+
+        auto n_read_bits = position % BYTE_BITS;
+        if (n_read_bits > 0) {
+            m_window = u64(input[m_offset]) << (WORD_BITS - BYTE_BITS + n_read_bits);
+            m_window_bits = BYTE_BITS - n_read_bits;
+            m_offset++;
+        }
+    }
+
+    // Same as 'BitWindow::refill', with the new bytes below the loaded ones.
+    constexpr void MsbBitWindow::refill(std::span<const u8> input) {
+        if (m_offset + sizeof(u64) <= input.size()) {
+            auto word = load_big_endian_word(input.data() + m_offset, sizeof(u64));
+            m_window |= word >> m_window_bits;
+
+            auto n_bytes = (WORD_BITS - 1 - m_window_bits) / BYTE_BITS;
+            m_offset += n_bytes;
+            m_window_bits += n_bytes * BYTE_BITS;
+            return;
+        }
+
+        while (m_window_bits <= WORD_BITS - BYTE_BITS && m_offset < input.size()) {
+            m_window |= u64(input[m_offset]) << (WORD_BITS - BYTE_BITS - m_window_bits);
+            m_offset++;
+            m_window_bits += BYTE_BITS;
+        }
+    }
+
+    // Consumes 'n_bits' (at most 56) from the window.
+    constexpr u64 MsbBitWindow::take_bits(std::span<const u8> input, std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS - BYTE_BITS);
+
+        if (m_window_bits < n_bits) {
+            this->refill(input);
+            assert(m_window_bits >= n_bits);
+        }
+
+        // Two shifts, as 'n_bits' may be zero.
+        auto bits = (m_window >> 1) >> (WORD_BITS - 1 - n_bits);
+        m_window <<= n_bits;
+        m_window_bits -= n_bits;
+        return bits;
+    }
+
+    template<std::size_t N>
+    constexpr u64 MsbBitWindow::take_bits(std::span<const u8> input) {
+        static_assert(N <= WORD_BITS - BYTE_BITS);
+
+        if constexpr (N == 0) {
+            return 0;
+        } else {
+            if (m_window_bits < N) {
+                this->refill(input);
+                assert(m_window_bits >= N);
+            }
+
+            auto bits = m_window >> (WORD_BITS - N);
+            m_window <<= N;
+            m_window_bits -= N;
+            return bits;
+        }
+    }
+
+    // Returns the next 'n_bits' (at most 56) without consuming them.
+    // Bits past the end of the input read as zeros.
+    constexpr u64 MsbBitWindow::peek_bits(std::span<const u8> input, std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS - BYTE_BITS);
+
+        if (m_window_bits < n_bits) {
+            this->refill(input);
+        }
+
+        auto loaded = m_window & ~low_bits_mask(WORD_BITS - std::min(n_bits, m_window_bits));
+        return (loaded >> 1) >> (WORD_BITS - 1 - n_bits);
+    }
+
+    constexpr void MsbBitWindow::consume_bits(std::size_t n_bits) {
+        assert(n_bits <= m_window_bits && n_bits <= WORD_BITS - BYTE_BITS);
+
+        m_window <<= n_bits;
+        m_window_bits -= n_bits;
+    }
+
+    template<typename T>
+    constexpr T MsbBitWindow::read_bits_as(std::span<const u8> input, std::size_t n_bits) {
+        static_assert((std::is_integral_v<T> || std::is_enum_v<T>) && sizeof(T) <= sizeof(u64),
+                "MSB-first streams only hold integral and enum items.");
+
+        if (n_bits <= WORD_BITS - BYTE_BITS) {
+            return static_cast<T>(this->take_bits(input, n_bits));
+        }
+
+        // The high bits come first.
+        const std::size_t low_bits = 32;
+        auto high = this->take_bits(input, n_bits - low_bits);
+        auto low = this->take_bits<low_bits>(input);
+        return static_cast<T>((high << low_bits) | low);
+    }
+
+    template<std::size_t N, typename T>
+    constexpr T MsbBitWindow::read_bits(std::span<const u8> input) {
+        static_assert((std::is_integral_v<T> || std::is_enum_v<T>) && sizeof(T) <= sizeof(u64),
+                "MSB-first streams only hold integral and enum items.");
+        static_assert(N <= sizeof(T) * BYTE_BITS, "Width 'N' is larger than the item.");
+
+        if constexpr (N <= WORD_BITS - BYTE_BITS) {
+            return static_cast<T>(this->take_bits<N>(input));
+        } else {
+            const std::size_t low_bits = 32;
+            auto high = this->take_bits<N - low_bits>(input);
+            auto low = this->take_bits<low_bits>(input);
+            return static_cast<T>((high << low_bits) | low);
+        }
+    }
+
+    // Engine of each bit order, for the readers and writers that take the
+    // order as a template parameter.
+    template<BitOrder Order>
+    struct BitOrderTraits;
+
+    template<>
+    struct BitOrderTraits<BitOrder::lsb_first> {
+        using Accumulator = BitAccumulator;
+        using Window = BitWindow;
+
+        static constexpr std::array<u8, sizeof(u64)> store(u64 word) { return store_word(word); }
+    };
+
+    template<>
+    struct BitOrderTraits<BitOrder::msb_first> {
+        using Accumulator = MsbBitAccumulator;
+        using Window = MsbBitWindow;
+
+        static constexpr std::array<u8, sizeof(u64)> store(u64 word) { return store_big_endian_word(word); }
+    };
+}
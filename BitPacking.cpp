@@ -0,0 +1,225 @@
+#include "BitPacking.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OUTBIT_HAS_X86_KERNELS 1
+#endif
+
+namespace outbit {
+    namespace {
+        template<std::size_t W>
+        void unpack_values(const u8* input, std::size_t first_bit, uint32_t* output, std::size_t n_values) {
+            for (std::size_t index = 0; index < n_values; index++) {
+                auto bit = first_bit + index * W;
+                auto word = load_word(input + bit / BYTE_BITS, sizeof(u64));
+                output[index] = static_cast<uint32_t>((word >> (bit % BYTE_BITS)) & low_bits_mask(W));
+            }
+        }
+
+        template<std::size_t... W>
+        constexpr auto make_unpack_kernels(std::index_sequence<W...>) {
+            return std::array<UnpackKernel, sizeof...(W)>{ &unpack_values<W>... };
+        }
+
+        void prefix_sum(const uint32_t* residuals, std::size_t n_values, u64 offset, u64 start, u64* output) {
+            for (std::size_t index = 0; index < n_values; index++) {
+                start += residuals[index] + offset;
+                output[index] = start;
+            }
+        }
+
+#ifdef OUTBIT_HAS_X86_KERNELS
+        // Gathers the bytes holding each value and shifts every lane by its
+        // own offset. Up to 25 bits, a value and its offset fit in a 32-bit
+        // lane, so 8 values are decoded at once. Wider values use 64-bit
+        // lanes, 4 at a time.
+        template<std::size_t W>
+        __attribute__((target("avx2")))
+        void unpack_values_avx2(const u8* input, std::size_t first_bit, uint32_t* output, std::size_t n_values) {
+            std::size_t index = 0;
+
+            if constexpr (W > 0 && W <= 25) {
+                const auto lane_bits = _mm256_setr_epi32(
+                        0, W, 2 * W, 3 * W, 4 * W, 5 * W, 6 * W, 7 * W);
+                const auto mask = _mm256_set1_epi32(static_cast<int>(low_bits_mask(W)));
+                const auto seven = _mm256_set1_epi32(BYTE_BITS - 1);
+
+                for (; index + 8 <= n_values; index += 8) {
+                    auto bit = first_bit + index * W;
+                    auto bits = _mm256_add_epi32(lane_bits,
+                            _mm256_set1_epi32(static_cast<int>(bit % BYTE_BITS)));
+                    auto byte_offsets = _mm256_srli_epi32(bits, 3);
+                    auto shifts = _mm256_and_si256(bits, seven);
+
+                    auto words = _mm256_i32gather_epi32(
+                            reinterpret_cast<const int*>(input + bit / BYTE_BITS), byte_offsets, 1);
+                    words = _mm256_and_si256(_mm256_srlv_epi32(words, shifts), mask);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index), words);
+                }
+            } else if constexpr (W > 25) {
+                const auto lane_bits = _mm_setr_epi32(0, W, 2 * W, 3 * W);
+                const auto mask = _mm256_set1_epi64x(static_cast<long long>(low_bits_mask(W)));
+                const auto seven = _mm_set1_epi32(BYTE_BITS - 1);
+                const auto even_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+                for (; index + 4 <= n_values; index += 4) {
+                    auto bit = first_bit + index * W;
+                    auto bits = _mm_add_epi32(lane_bits,
+                            _mm_set1_epi32(static_cast<int>(bit % BYTE_BITS)));
+                    auto byte_offsets = _mm_srli_epi32(bits, 3);
+                    auto shifts = _mm256_cvtepu32_epi64(_mm_and_si128(bits, seven));
+
+                    auto words = _mm256_i32gather_epi64(
+                            reinterpret_cast<const long long*>(input + bit / BYTE_BITS), byte_offsets, 1);
+                    words = _mm256_and_si256(_mm256_srlv_epi64(words, shifts), mask);
+                    words = _mm256_permutevar8x32_epi32(words, even_lanes);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index),
+                            _mm256_castsi256_si128(words));
+                }
+            }
+
+            unpack_values<W>(input, first_bit + index * W, output + index, n_values - index);
+        }
+
+        template<std::size_t... W>
+        constexpr auto make_avx2_unpack_kernels(std::index_sequence<W...>) {
+            return std::array<UnpackKernel, sizeof...(W)>{ &unpack_values_avx2<W>... };
+        }
+
+        // Merges 8 values into fewer, wider fields before they reach the
+        // accumulator: each pair of 32-bit lanes becomes one 64-bit lane of
+        // 2W bits, then up to 16 bits the pairs are merged into fields of
+        // 4W bits, and up to 8 bits into one field of 8W bits.
+        template<std::size_t W>
+        __attribute__((target("avx2")))
+        u8* pack_values_avx2(const uint32_t* values, std::size_t n_values, BitAccumulator& accumulator, u8* output) {
+            std::size_t index = 0;
+
+            if constexpr (W > 0) {
+                const auto mask = _mm256_set1_epi32(static_cast<int>(low_bits_mask(W)));
+                const auto low_halves = _mm256_set1_epi64x(static_cast<long long>(low_bits_mask(32)));
+                auto spill = [&output](u64 word) {
+                    auto word_bytes = store_word(word);
+                    std::memcpy(output, word_bytes.data(), word_bytes.size());
+                    output += word_bytes.size();
+                };
+
+                for (; index + 8 <= n_values; index += 8) {
+                    auto lanes = _mm256_and_si256(mask,
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + index)));
+                    auto pairs = _mm256_or_si256(_mm256_and_si256(lanes, low_halves),
+                            _mm256_slli_epi64(_mm256_srli_epi64(lanes, 32), W));
+
+                    alignas(32) auto fields = std::array<u64, 4>();
+                    if constexpr (W <= 16) {
+                        // Fields of 4W bits in the lanes 0 and 2.
+                        auto quads = _mm256_or_si256(pairs,
+                                _mm256_slli_epi64(_mm256_bsrli_epi128(pairs, 8), 2 * W));
+                        _mm256_store_si256(reinterpret_cast<__m256i*>(fields.data()), quads);
+
+                        if constexpr (W <= 8) {
+                            accumulator.push(fields[0] | fields[2] << (4 * W), 8 * W, spill);
+                        } else {
+                            accumulator.push(fields[0], 4 * W, spill);
+                            accumulator.push(fields[2], 4 * W, spill);
+                        }
+                    } else {
+                        _mm256_store_si256(reinterpret_cast<__m256i*>(fields.data()), pairs);
+                        for (auto field : fields) {
+                            accumulator.push(field, 2 * W, spill);
+                        }
+                    }
+                }
+            }
+
+            return pack_values<uint32_t, W>(values + index, n_values - index, accumulator, output);
+        }
+
+        template<std::size_t... W>
+        constexpr auto make_avx2_pack_kernels(std::index_sequence<W...>) {
+            return std::array<PackKernel<uint32_t>, sizeof...(W)>{ &pack_values_avx2<W>... };
+        }
+
+        // Sums 4 values at a time: two shifted additions give the sums
+        // within the lanes, then the total of the previous lanes is added.
+        __attribute__((target("avx2")))
+        void prefix_sum_avx2(const uint32_t* residuals, std::size_t n_values, u64 offset, u64 start, u64* output) {
+            const auto offsets = _mm256_set1_epi64x(static_cast<long long>(offset));
+            const auto zero = _mm256_setzero_si256();
+            auto carry = _mm256_set1_epi64x(static_cast<long long>(start));
+
+            std::size_t index = 0;
+            for (; index + 4 <= n_values; index += 4) {
+                auto values = _mm256_cvtepu32_epi64(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(residuals + index)));
+                values = _mm256_add_epi64(values, offsets);
+
+                auto shifted = _mm256_blend_epi32(
+                        _mm256_permute4x64_epi64(values, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0b00000011);
+                values = _mm256_add_epi64(values, shifted);
+                values = _mm256_add_epi64(values, _mm256_permute2x128_si256(values, values, 0x08));
+                values = _mm256_add_epi64(values, carry);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + index), values);
+                carry = _mm256_permute4x64_epi64(values, _MM_SHUFFLE(3, 3, 3, 3));
+            }
+
+            if (index > 0) {
+                start = output[index - 1];
+            }
+            prefix_sum(residuals + index, n_values - index, offset, start, output + index);
+        }
+#endif
+
+        using UnpackKernels = std::array<UnpackKernel, MAX_PACKED_WIDTH + 1>;
+
+        const UnpackKernels& select_unpack_kernels() {
+            static constexpr UnpackKernels scalar_kernels =
+                make_unpack_kernels(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+
+#ifdef OUTBIT_HAS_X86_KERNELS
+            static constexpr UnpackKernels avx2_kernels =
+                make_avx2_unpack_kernels(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+
+            if (__builtin_cpu_supports("avx2")) {
+                return avx2_kernels;
+            }
+#endif
+
+            return scalar_kernels;
+        }
+    }
+
+    PackKernel<uint32_t> pack_uint32_kernel(std::size_t width) {
+        static constexpr auto scalar_kernels =
+            make_pack_kernels<uint32_t>(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+
+#ifdef OUTBIT_HAS_X86_KERNELS
+        static constexpr auto avx2_kernels =
+            make_avx2_pack_kernels(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+        static const auto& kernels = __builtin_cpu_supports("avx2") ? avx2_kernels : scalar_kernels;
+#else
+        static const auto& kernels = scalar_kernels;
+#endif
+
+        assert(width <= MAX_PACKED_WIDTH);
+        return kernels[width];
+    }
+
+    PrefixSumKernel prefix_sum_kernel() {
+#ifdef OUTBIT_HAS_X86_KERNELS
+        static const auto kernel = __builtin_cpu_supports("avx2") ? &prefix_sum_avx2 : &prefix_sum;
+#else
+        static const auto kernel = &prefix_sum;
+#endif
+
+        return kernel;
+    }
+
+    UnpackKernel unpack_kernel(std::size_t width) {
+        static const auto& kernels = select_unpack_kernels();
+
+        assert(width <= MAX_PACKED_WIDTH);
+        return kernels[width];
+    }
+}
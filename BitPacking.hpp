@@ -0,0 +1,74 @@
+#pragma once
+
+#include "BitEngine.hpp"
+#include <utility>
+
+// Kernels that pack and unpack arrays of values sharing one bit width.
+// Each width from 0 to 32 has its own kernel, so masks and shifts are
+// constants. The layout is the one of consecutive 'write_bits' calls.
+namespace outbit {
+    const std::size_t MAX_PACKED_WIDTH = 32;
+
+    // Pushes the 'W' low bits of every value into 'accumulator'. Spilled
+    // words are stored at 'output', which must have room for all of them.
+    // Returns the end of the stored words.
+    template<typename T, std::size_t W>
+    u8* pack_values(const T* values, std::size_t n_values, BitAccumulator& accumulator, u8* output) {
+        static_assert(std::is_integral_v<T>);
+        static_assert(W <= MAX_PACKED_WIDTH);
+
+        for (std::size_t index = 0; index < n_values; index++) {
+            auto bits = static_cast<u64>(values[index]) & low_bits_mask(W);
+            accumulator.push(bits, W, [&output](u64 word) {
+                auto word_bytes = store_word(word);
+                std::memcpy(output, word_bytes.data(), word_bytes.size());
+                output += word_bytes.size();
+            });
+        }
+
+        return output;
+    }
+
+    template<typename T>
+    using PackKernel = u8* (*)(const T*, std::size_t, BitAccumulator&, u8*);
+
+    template<typename T, std::size_t... W>
+    constexpr auto make_pack_kernels(std::index_sequence<W...>) {
+        return std::array<PackKernel<T>, sizeof...(W)>{ &pack_values<T, W>... };
+    }
+
+    // Picks the fastest kernel the running CPU supports (AVX2 or scalar).
+    PackKernel<uint32_t> pack_uint32_kernel(std::size_t width);
+
+    // Values of other types always use the scalar kernels.
+    template<typename T>
+    PackKernel<T> pack_kernel(std::size_t width) {
+        static constexpr auto kernels =
+            make_pack_kernels<T>(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+
+        assert(width <= MAX_PACKED_WIDTH);
+        if constexpr (std::is_same_v<T, uint32_t>) {
+            return pack_uint32_kernel(width);
+        } else {
+            return kernels[width];
+        }
+    }
+
+    // Decodes 'n_values' values starting at bit 'first_bit' of 'input'.
+    // At least 8 readable bytes must follow the byte holding the first bit
+    // of the last value.
+    using UnpackKernel = void (*)(const u8* input, std::size_t first_bit,
+            uint32_t* output, std::size_t n_values);
+
+    // Picks the fastest kernel the running CPU supports (AVX2 or scalar).
+    UnpackKernel unpack_kernel(std::size_t width);
+
+    // Rebuilds 'n_values' values from their differences: 'output[i]' is
+    // 'start' plus the sum of 'residuals[j] + offset' for every j <= i,
+    // with wrapping 64-bit arithmetic.
+    using PrefixSumKernel = void (*)(const uint32_t* residuals, std::size_t n_values,
+            u64 offset, u64 start, u64* output);
+
+    // Picks the fastest kernel the running CPU supports (AVX2 or scalar).
+    PrefixSumKernel prefix_sum_kernel();
+}
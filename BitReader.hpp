@@ -0,0 +1,118 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+
+namespace outbit {
+    // Non-owning counterpart of BitBuffer's read side. It decodes straight
+    // from caller-owned memory, which must outlive the reader and must not
+    // change while it is being read.
+    template<BitOrder Order>
+    class BasicBitReader {
+        public:
+            BasicBitReader() = default;
+            // Bytes can be read at compile time, as written by 'FixedBitWriter'.
+            constexpr explicit BasicBitReader(std::span<const u8> bytes);
+            explicit BasicBitReader(std::span<const std::byte> bytes);
+            template<typename T>
+            explicit BasicBitReader(std::span<const T> slice);
+
+            template<typename T>
+            constexpr T read_as();
+            template<typename T>
+            constexpr T read_bits_as(std::size_t n_bits);
+            template<std::size_t N, typename T>
+            constexpr T read_bits();
+
+            // Returns the next 'n_bits' (at most 56) without moving the read
+            // position. Bits past the end read as zeros.
+            constexpr u64 peek_bits(std::size_t n_bits);
+            // Moves the read position by 'n_bits' (at most 56).
+            constexpr void consume_bits(std::size_t n_bits);
+
+            constexpr std::size_t size_in_bits() const;
+            constexpr std::size_t remaining_bits() const;
+            constexpr std::span<const u8> bytes() const;
+
+        private:
+            std::span<const u8> m_input;
+            typename BitOrderTraits<Order>::Window m_read_window;
+    };
+
+    using BitReader = BasicBitReader<BitOrder::lsb_first>;
+    // Reads MSB-first streams, such as JPEG or H.264 ones, in place. Only
+    // integral and enum items can be read.
+    using MsbBitReader = BasicBitReader<BitOrder::msb_first>;
+
+    template<BitOrder Order>
+    constexpr BasicBitReader<Order>::BasicBitReader(std::span<const u8> bytes)
+        : m_input(bytes)
+    {
+    }
+
+    template<BitOrder Order>
+    BasicBitReader<Order>::BasicBitReader(std::span<const std::byte> bytes)
+        : m_input(reinterpret_cast<const u8*>(bytes.data()), bytes.size())
+    {
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    BasicBitReader<Order>::BasicBitReader(std::span<const T> slice)
+        : BasicBitReader(std::as_bytes(slice))
+    {
+    }
+
+    template<BitOrder Order>
+    constexpr std::size_t BasicBitReader<Order>::size_in_bits() const {
+        return m_input.size() * BYTE_BITS;
+    }
+
+    template<BitOrder Order>
+    constexpr std::size_t BasicBitReader<Order>::remaining_bits() const {
+        return this->size_in_bits() - m_read_window.position();
+    }
+
+    template<BitOrder Order>
+    constexpr std::span<const u8> BasicBitReader<Order>::bytes() const {
+        return m_input;
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    constexpr T BasicBitReader<Order>::read_as() {
+        return this->read_bits_as<T>(sizeof(T) * BYTE_BITS);
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    constexpr T BasicBitReader<Order>::read_bits_as(std::size_t n_bits) {
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+        assert(n_bits <= this->remaining_bits());
+
+        return m_read_window.template read_bits_as<T>(m_input, n_bits);
+    }
+
+    template<BitOrder Order>
+    template<std::size_t N, typename T>
+    constexpr T BasicBitReader<Order>::read_bits() {
+        assert(N <= this->remaining_bits());
+
+        return m_read_window.template read_bits<N, T>(m_input);
+    }
+
+    template<BitOrder Order>
+    constexpr u64 BasicBitReader<Order>::peek_bits(std::size_t n_bits) {
+        return m_read_window.peek_bits(m_input, n_bits);
+    }
+
+    template<BitOrder Order>
+    constexpr void BasicBitReader<Order>::consume_bits(std::size_t n_bits) {
+        assert(n_bits <= this->remaining_bits());
+
+        if (n_bits <= m_read_window.window_bits()) {
+            m_read_window.consume_bits(n_bits);
+        } else {
+            m_read_window.take_bits(m_input, n_bits);
+        }
+    }
+}
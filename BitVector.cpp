@@ -0,0 +1,247 @@
+#include "BitVector.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OUTBIT_HAS_X86_KERNELS 1
+#endif
+
+namespace outbit {
+    namespace {
+        const std::size_t BLOCK_WORDS = BitVector::BLOCK_BITS / WORD_BITS;
+
+        // Counts the ones of the first 'n_bits' of a block.
+        using CountOnesKernel = std::size_t (*)(const u8* block, std::size_t n_bits);
+        // Position of the one with 'rank' ones before it in a block, which
+        // must have more than 'rank' ones.
+        using SelectOneKernel = std::size_t (*)(const u8* block, std::size_t rank);
+
+        // Halves the word down to a byte by popcounts, then clears the lower
+        // ones of that byte.
+        [[gnu::always_inline]] inline std::size_t select_in_word(u64 word, std::size_t rank) {
+            std::size_t shift = 0;
+            for (std::size_t half = WORD_BITS / 2; half >= BYTE_BITS; half /= 2) {
+                auto low_ones = static_cast<std::size_t>(std::popcount(word & low_bits_mask(half)));
+                if (rank >= low_ones) {
+                    word >>= half;
+                    shift += half;
+                    rank -= low_ones;
+                }
+            }
+
+            for (; rank > 0; rank--) {
+                word &= word - 1;
+            }
+
+            return shift + static_cast<std::size_t>(std::countr_zero(word));
+        }
+
+        // Masks instead of branching on 'n_bits', whose words are random.
+        [[gnu::always_inline]] inline std::size_t count_block_ones(const u8* block, std::size_t n_bits) {
+            std::size_t n_ones = 0;
+            for (std::size_t index = 0; index < BLOCK_WORDS; index++) {
+                auto word_bits = std::min(n_bits - std::min(n_bits, index * WORD_BITS), WORD_BITS);
+                auto mask = word_bits == 0 ? 0 : ~u64(0) >> (WORD_BITS - word_bits);
+                n_ones += static_cast<std::size_t>(std::popcount(load_word(block + index * sizeof(u64), sizeof(u64)) & mask));
+            }
+
+            return n_ones;
+        }
+
+        std::size_t select_one(const u8* block, std::size_t rank) {
+            for (std::size_t index = 0;; index++) {
+                auto word = load_word(block + index * sizeof(u64), sizeof(u64));
+                auto n_ones = static_cast<std::size_t>(std::popcount(word));
+                if (rank < n_ones) {
+                    return index * WORD_BITS + select_in_word(word, rank);
+                }
+
+                rank -= n_ones;
+            }
+        }
+
+        std::size_t count_ones(const u8* block, std::size_t n_bits) {
+            return count_block_ones(block, n_bits);
+        }
+
+#ifdef OUTBIT_HAS_X86_KERNELS
+        __attribute__((target("popcnt,bmi2")))
+        std::size_t count_ones_x86(const u8* block, std::size_t n_bits) {
+            return count_block_ones(block, n_bits);
+        }
+
+        // Deposits a single bit on the one searched for, instead of 'select_in_word'.
+        __attribute__((target("popcnt,bmi,bmi2")))
+        std::size_t select_one_x86(const u8* block, std::size_t rank) {
+            for (std::size_t index = 0;; index++) {
+                auto word = load_word(block + index * sizeof(u64), sizeof(u64));
+                auto n_ones = static_cast<std::size_t>(_mm_popcnt_u64(word));
+                if (rank < n_ones) {
+                    return index * WORD_BITS + _tzcnt_u64(_pdep_u64(u64(1) << rank, word));
+                }
+
+                rank -= n_ones;
+            }
+        }
+
+        bool has_x86_kernels() {
+            return __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+        }
+#endif
+
+        CountOnesKernel count_ones_kernel() {
+#ifdef OUTBIT_HAS_X86_KERNELS
+            static const auto kernel = has_x86_kernels() ? &count_ones_x86 : &count_ones;
+#else
+            static const auto kernel = &count_ones;
+#endif
+
+            return kernel;
+        }
+
+        SelectOneKernel select_one_kernel() {
+#ifdef OUTBIT_HAS_X86_KERNELS
+            static const auto kernel = has_x86_kernels() ? &select_one_x86 : &select_one;
+#else
+            static const auto kernel = &select_one;
+#endif
+
+            return kernel;
+        }
+    }
+
+    BitVector::BitVector(std::span<const u8> bytes, std::size_t n_bits)
+        : m_bytes(bytes.first((n_bits + BYTE_BITS - 1) / BYTE_BITS)),
+          m_n_bits(n_bits),
+          m_region_ranks(n_bits / REGION_BITS + 1),
+          m_superblocks(n_bits / SUPERBLOCK_BITS + 1)
+    {
+        assert(n_bits <= bytes.size() * BYTE_BITS);
+        assert(m_superblocks.size() <= std::numeric_limits<uint32_t>::max());
+
+        const auto count_ones = count_ones_kernel();
+        const auto region_blocks = REGION_BITS / BLOCK_BITS;
+
+        std::array<u8, BLOCK_BYTES> padded;
+        auto n_blocks = (n_bits + BLOCK_BITS - 1) / BLOCK_BITS;
+        std::size_t next_sample = 0;
+        for (std::size_t block = 0; block < n_blocks; block++) {
+            auto superblock = block / SUPERBLOCK_BLOCKS;
+            if (block % region_blocks == 0) {
+                m_region_ranks[block / region_blocks] = m_n_ones;
+            }
+            if (block % SUPERBLOCK_BLOCKS == 0) {
+                m_superblocks[superblock] = m_n_ones - m_region_ranks[block / region_blocks];
+            }
+
+            // Bits of the last byte past 'n_bits' are not part of the vector.
+            auto n_ones = count_ones(this->block_bytes(block, padded), std::min(n_bits - block * BLOCK_BITS, BLOCK_BITS));
+            if (block % SUPERBLOCK_BLOCKS < SUPERBLOCK_BLOCKS - 1) {
+                m_superblocks[superblock] += u64(n_ones) << (32 + block % SUPERBLOCK_BLOCKS * BLOCK_COUNT_BITS);
+            }
+
+            for (; next_sample < m_n_ones + n_ones; next_sample += SELECT_SAMPLE) {
+                m_select_samples.push_back(static_cast<uint32_t>(superblock));
+            }
+            m_n_ones += n_ones;
+        }
+
+        // Entries starting at 'n_bits' itself, which no block starts.
+        if (n_bits % REGION_BITS == 0) {
+            m_region_ranks.back() = m_n_ones;
+        }
+        if (n_bits % SUPERBLOCK_BITS == 0) {
+            m_superblocks.back() = m_n_ones - m_region_ranks[n_bits / REGION_BITS];
+        }
+    }
+
+    BitVector::BitVector(BitBuffer& bitbuffer)
+        : BitVector(bitbuffer.bytes(), BitVector::stored_bits(bitbuffer))
+    {
+    }
+
+    // In 'BufferMode::fifo', 'size_in_bits' also counts the dropped bytes,
+    // which 'bytes' no longer holds.
+    std::size_t BitVector::stored_bits(BitBuffer& bitbuffer) {
+        auto n_bytes = bitbuffer.bytes().size();
+        auto n_bits = bitbuffer.size_in_bits();
+        auto n_dropped_bytes = (n_bits + BYTE_BITS - 1) / BYTE_BITS - n_bytes;
+
+        return n_bits - n_dropped_bytes * BYTE_BITS;
+    }
+
+    const u8* BitVector::block_bytes(std::size_t block, std::array<u8, BLOCK_BYTES>& padded) const {
+        auto offset = block * BLOCK_BYTES;
+        assert(offset < m_bytes.size());
+
+        if (offset + BLOCK_BYTES <= m_bytes.size()) {
+            return m_bytes.data() + offset;
+        }
+
+        padded.fill(0);
+        std::memcpy(padded.data(), m_bytes.data() + offset, m_bytes.size() - offset);
+        return padded.data();
+    }
+
+    std::size_t BitVector::rank1(std::size_t position) const {
+        assert(position <= m_n_bits);
+
+        auto entry = m_superblocks[position / SUPERBLOCK_BITS];
+        std::size_t rank = m_region_ranks[position / REGION_BITS] + (entry & 0xffff'ffff);
+
+        // Without branches, whose outcome would be random.
+        auto block = position / BLOCK_BITS % SUPERBLOCK_BLOCKS;
+        for (std::size_t index = 0; index < SUPERBLOCK_BLOCKS - 1; index++) {
+            rank += index < block ? BitVector::block_count(entry, index) : 0;
+        }
+
+        auto block_bits = position % BLOCK_BITS;
+        if (block_bits == 0) {
+            return rank;
+        }
+
+        std::array<u8, BLOCK_BYTES> padded;
+        return rank + count_ones_kernel()(this->block_bytes(position / BLOCK_BITS, padded), block_bits);
+    }
+
+    std::size_t BitVector::select1(std::size_t rank) const {
+        assert(rank < m_n_ones);
+
+        // The sampled superblocks hold the ones of rank 'sample * SELECT_SAMPLE',
+        // so the one searched for is in between. Searches the last superblock
+        // with at most 'rank' ones before it.
+        auto sample = rank / SELECT_SAMPLE;
+        std::size_t first = m_select_samples[sample];
+        std::size_t last = sample + 1 < m_select_samples.size() ? m_select_samples[sample + 1] + 1 : m_superblocks.size();
+        while (last - first > 1) {
+            auto middle = first + (last - first) / 2;
+            if (this->superblock_rank(middle) <= rank) {
+                first = middle;
+            } else {
+                last = middle;
+            }
+        }
+        rank -= this->superblock_rank(first);
+
+        auto entry = m_superblocks[first];
+        auto block = first * SUPERBLOCK_BLOCKS;
+        for (std::size_t index = 0; index < SUPERBLOCK_BLOCKS - 1; index++) {
+            auto n_ones = BitVector::block_count(entry, index);
+            if (rank < n_ones) {
+                break;
+            }
+
+            rank -= n_ones;
+            block++;
+        }
+
+        // Bits past 'n_bits' come after the one searched for, the padding needs no mask.
+        std::array<u8, BLOCK_BYTES> padded;
+        return block * BLOCK_BITS + select_one_kernel()(this->block_bytes(block, padded), rank);
+    }
+
+    std::size_t BitVector::index_size_in_bytes() const {
+        return m_region_ranks.size() * sizeof(u64)
+            + m_superblocks.size() * sizeof(u64)
+            + m_select_samples.size() * sizeof(uint32_t);
+    }
+}
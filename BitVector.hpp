@@ -0,0 +1,94 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include <vector>
+
+namespace outbit {
+    // Read-only view of a bitmap with a rank/select index. Bit 'i' is bit
+    // 'i % 8' of byte 'i / 8', as BitBuffer writes them. The bytes must
+    // outlive the view and must not change while it is used.
+    //
+    // The index takes about 3.2% of the bitmap. Every superblock of 2048
+    // bits has one 64-bit entry, so a rank costs one cache miss in the
+    // index and one in the bitmap:
+    //
+    //  - the low 32 bits count the ones before the superblock, from the
+    //    start of its region of 2^32 bits, whose own count is kept aside;
+    //  - the next 3 x 10 bits count the ones of the first three blocks of
+    //    512 bits of the superblock.
+    //
+    // The superblock of every 8192nd one is sampled, so that 'select1' only
+    // searches the superblocks between two samples before scanning at most
+    // 4 blocks. Blocks are counted and searched with the POPCNT and BMI2
+    // instructions when the CPU supports them.
+    class BitVector {
+        public:
+            static constexpr std::size_t BLOCK_BITS = 512;
+            static constexpr std::size_t SUPERBLOCK_BITS = 2048;
+            static constexpr std::size_t REGION_BITS = std::size_t(1) << 32;
+            static constexpr std::size_t SELECT_SAMPLE = 8192;
+
+            BitVector() = default;
+            BitVector(std::span<const u8> bytes, std::size_t n_bits);
+            // Views the bits written to the buffer. Writing to the buffer
+            // afterwards invalidates the view. In 'BufferMode::fifo',
+            // positions start at the first byte not dropped yet.
+            explicit BitVector(BitBuffer& bitbuffer);
+
+            // 'position' must be lower than 'size_in_bits'.
+            bool access(std::size_t position) const;
+            // Number of ones before 'position', which may be 'size_in_bits'.
+            std::size_t rank1(std::size_t position) const;
+            std::size_t rank0(std::size_t position) const;
+            // Position of the one with 'rank' ones before it. 'rank' must be
+            // lower than 'count_ones'.
+            std::size_t select1(std::size_t rank) const;
+
+            std::size_t size_in_bits() const { return m_n_bits; }
+            std::size_t count_ones() const { return m_n_ones; }
+            // Bytes taken by the index, next to the viewed bytes.
+            std::size_t index_size_in_bytes() const;
+
+        private:
+            static constexpr std::size_t BLOCK_BYTES = BLOCK_BITS / BYTE_BITS;
+            static constexpr std::size_t SUPERBLOCK_BLOCKS = SUPERBLOCK_BITS / BLOCK_BITS;
+            static constexpr std::size_t BLOCK_COUNT_BITS = 10;
+
+            // The bytes of a block, or a copy padded with zeros for a last
+            // block cut short.
+            const u8* block_bytes(std::size_t block, std::array<u8, BLOCK_BYTES>& padded) const;
+            // Number of ones before the superblock.
+            std::size_t superblock_rank(std::size_t superblock) const;
+            static std::size_t block_count(u64 entry, std::size_t block);
+            // Bits of 'bitbuffer.bytes()'.
+            static std::size_t stored_bits(BitBuffer& bitbuffer);
+
+            std::span<const u8> m_bytes;
+            std::size_t m_n_bits = 0;
+            std::size_t m_n_ones = 0;
+            // Entries start at every multiple of their size up to
+            // 'size_in_bits' included, so a rank of 'size_in_bits' needs no
+            // special case.
+            std::vector<u64> m_region_ranks = {0};
+            std::vector<u64> m_superblocks = {0};
+            std::vector<uint32_t> m_select_samples;
+    };
+
+    inline std::size_t BitVector::superblock_rank(std::size_t superblock) const {
+        return m_region_ranks[superblock * SUPERBLOCK_BITS / REGION_BITS] + (m_superblocks[superblock] & 0xffff'ffff);
+    }
+
+    inline std::size_t BitVector::block_count(u64 entry, std::size_t block) {
+        return (entry >> (32 + block * BLOCK_COUNT_BITS)) & ((u64(1) << BLOCK_COUNT_BITS) - 1);
+    }
+
+    inline bool BitVector::access(std::size_t position) const {
+        assert(position < m_n_bits);
+
+        return (m_bytes[position / BYTE_BITS] >> (position % BYTE_BITS)) & 1;
+    }
+
+    inline std::size_t BitVector::rank0(std::size_t position) const {
+        return position - this->rank1(position);
+    }
+}
@@ -0,0 +1,312 @@
+#include "BitWriter.hpp"
+#include <cerrno>
+#include <exception>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace outbit {
+    FdSink::FdSink(int file_descriptor)
+        : m_file_descriptor(file_descriptor)
+    {
+    }
+
+    void FdSink::write(std::span<const u8> bytes, const std::source_location caller_location) {
+        while (!bytes.empty()) {
+            auto written = ::write(m_file_descriptor, bytes.data(), bytes.size());
+
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (written < 0) {
+                auto callee_location = std::source_location::current();
+                auto erro_msg =
+                    std::format(
+                            "[{}:{}] Method '{}' failed to write to file descriptor {}. {}.",
+                            caller_location.file_name(),
+                            caller_location.line(),
+                            callee_location.function_name(),
+                            m_file_descriptor,
+                            std::strerror(errno));
+
+                throw std::runtime_error(erro_msg);
+            }
+
+            bytes = bytes.subspan(static_cast<std::size_t>(written));
+        }
+    }
+
+    FileSink::FileSink(std::FILE* file)
+        : m_file(file)
+    {
+    }
+
+    void FileSink::write(std::span<const u8> bytes, const std::source_location caller_location) {
+        if (std::fwrite(bytes.data(), 1, bytes.size(), m_file) != bytes.size()) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to write {} bytes to the stream.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        bytes.size());
+
+            throw std::runtime_error(erro_msg);
+        }
+    }
+
+    void FileSink::flush(const std::source_location caller_location) {
+        if (std::fflush(m_file) != 0) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to flush the stream.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name());
+
+            throw std::runtime_error(erro_msg);
+        }
+    }
+
+    CallbackSink::CallbackSink(Callback callback)
+        : m_callback(std::move(callback))
+    {
+    }
+
+    void CallbackSink::write(std::span<const u8> bytes, const std::source_location) {
+        m_callback(bytes);
+    }
+
+    void MemorySink::write(std::span<const u8> bytes, const std::source_location) {
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+    AsyncFileSink::AsyncFileSink(const fs::path& filepath, std::size_t buffer_size,
+            const std::source_location caller_location)
+        : m_filepath(filepath), m_buffer_size{buffer_size}
+    {
+        assert(m_buffer_size > 0);
+
+        m_file_descriptor = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_file_descriptor < 0) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to create file '{}'. {}.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        filepath.string(),
+                        std::strerror(errno));
+
+            throw std::runtime_error(erro_msg);
+        }
+
+        for (auto& buffer : m_buffers) {
+            buffer.reserve(m_buffer_size);
+        }
+
+        m_thread = std::jthread([this](std::stop_token stop_token) {
+            this->write_buffers(stop_token);
+        });
+    }
+
+    AsyncFileSink::~AsyncFileSink() {
+        try {
+            this->close();
+        } catch (const std::runtime_error&) {
+            // Only 'close' reports errors.
+        }
+    }
+
+    void AsyncFileSink::write_buffers(std::stop_token stop_token) {
+        auto lock = std::unique_lock(m_mutex);
+        while (m_condition.wait(lock, stop_token, [this] { return m_pending; })) {
+            auto& buffer = m_buffers[1 - m_filling];
+            lock.unlock();
+
+            auto bytes = std::span<const u8>(buffer);
+            auto error = 0;
+            while (!bytes.empty()) {
+                auto written = ::write(m_file_descriptor, bytes.data(), bytes.size());
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (written < 0) {
+                    error = errno;
+                    break;
+                }
+
+                bytes = bytes.subspan(static_cast<std::size_t>(written));
+            }
+
+            lock.lock();
+            if (error != 0 && m_error.empty()) {
+                m_error = std::strerror(error);
+            }
+
+            buffer.clear();
+            m_pending = false;
+            m_condition.notify_all();
+        }
+    }
+
+    void AsyncFileSink::throw_error(std::string_view reason, const std::source_location caller_location,
+            const std::source_location callee_location) const {
+        auto erro_msg =
+            std::format(
+                    "[{}:{}] Method '{}' failed to write to '{}'. {}.",
+                    caller_location.file_name(),
+                    caller_location.line(),
+                    callee_location.function_name(),
+                    m_filepath.string(),
+                    reason);
+
+        throw std::runtime_error(erro_msg);
+    }
+
+    void AsyncFileSink::wait_for_thread(std::unique_lock<std::mutex>& lock, const std::source_location caller_location,
+            const std::source_location callee_location) {
+        m_condition.wait(lock, [this] { return !m_pending; });
+
+        if (!m_error.empty()) {
+            this->throw_error(m_error, caller_location, callee_location);
+        }
+    }
+
+    void AsyncFileSink::submit(const std::source_location caller_location, const std::source_location callee_location) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            this->wait_for_thread(lock, caller_location, callee_location);
+
+            // The other buffer was emptied by the thread.
+            m_filling = 1 - m_filling;
+            m_pending = true;
+        }
+
+        m_condition.notify_all();
+    }
+
+    void AsyncFileSink::write(std::span<const u8> bytes, const std::source_location caller_location) {
+        auto callee_location = std::source_location::current();
+        if (m_file_descriptor < 0) {
+            this->throw_error("The file is closed", caller_location, callee_location);
+        }
+
+        while (!bytes.empty()) {
+            auto& buffer = m_buffers[m_filling];
+            auto n_bytes = std::min(bytes.size(), m_buffer_size - buffer.size());
+            buffer.insert(buffer.end(), bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(n_bytes));
+            bytes = bytes.subspan(n_bytes);
+
+            if (buffer.size() == m_buffer_size) {
+                this->submit(caller_location, callee_location);
+            }
+        }
+    }
+
+    void AsyncFileSink::flush(const std::source_location caller_location) {
+        if (m_file_descriptor < 0) {
+            return;
+        }
+
+        auto callee_location = std::source_location::current();
+        if (!m_buffers[m_filling].empty()) {
+            this->submit(caller_location, callee_location);
+        }
+
+        auto lock = std::unique_lock(m_mutex);
+        this->wait_for_thread(lock, caller_location, callee_location);
+    }
+
+    void AsyncFileSink::close(const std::source_location caller_location) {
+        if (m_file_descriptor < 0) {
+            return;
+        }
+
+        // The file is closed even when the last writes failed.
+        auto flush_error = std::exception_ptr();
+        try {
+            this->flush(caller_location);
+        } catch (const std::runtime_error&) {
+            flush_error = std::current_exception();
+        }
+
+        m_thread.request_stop();
+        m_thread.join();
+
+        auto closed = ::close(m_file_descriptor) == 0;
+        m_file_descriptor = -1;
+        if (flush_error) {
+            std::rethrow_exception(flush_error);
+        }
+
+        if (!closed) {
+            this->throw_error(std::strerror(errno), caller_location, std::source_location::current());
+        }
+    }
+
+    template<BitOrder Order>
+    BasicBitWriter<Order>::BasicBitWriter(ByteSink& sink, std::size_t block_size)
+        : m_sink(sink), m_block_size{block_size}
+    {
+        assert(m_block_size > 0);
+
+        // A spilled word may overshoot the block size by up to 7 bytes.
+        m_block.reserve(m_block_size + sizeof(u64));
+    }
+
+    template<BitOrder Order>
+    void BasicBitWriter<Order>::spill_word(u64 word, const std::source_location caller_location) {
+        auto word_bytes = Traits::store(word);
+        m_block.insert(m_block.end(), word_bytes.begin(), word_bytes.end());
+
+        if (m_block.size() >= m_block_size) {
+            this->flush_block(caller_location);
+        }
+    }
+
+    template<BitOrder Order>
+    void BasicBitWriter<Order>::flush_block(const std::source_location caller_location) {
+        if (m_block.empty()) {
+            return;
+        }
+
+        m_sink.write(m_block, caller_location);
+        m_flushed_bytes += m_block.size();
+        m_block.clear();
+    }
+
+    template<BitOrder Order>
+    void BasicBitWriter<Order>::flush(const std::source_location caller_location) {
+        auto n_bytes = m_accumulator.size() / BYTE_BITS;
+        auto word_bytes = Traits::store(m_accumulator.bits());
+        m_block.insert(m_block.end(), word_bytes.begin(), word_bytes.begin() + n_bytes);
+        m_accumulator.drop(n_bytes * BYTE_BITS);
+
+        this->flush_block(caller_location);
+    }
+
+    template<BitOrder Order>
+    void BasicBitWriter<Order>::finish(const std::source_location caller_location) {
+        auto n_bytes = BitBuffer::from_bits_to_bytes_length(m_accumulator.size());
+        auto word_bytes = Traits::store(m_accumulator.bits());
+        m_block.insert(m_block.end(), word_bytes.begin(), word_bytes.begin() + n_bytes);
+        m_accumulator.clear();
+
+        this->flush_block(caller_location);
+        m_sink.flush(caller_location);
+    }
+
+    template<BitOrder Order>
+    std::size_t BasicBitWriter<Order>::written_bits() const {
+        return (m_flushed_bytes + m_block.size()) * BYTE_BITS + m_accumulator.size();
+    }
+
+    template class BasicBitWriter<BitOrder::lsb_first>;
+    template class BasicBitWriter<BitOrder::msb_first>;
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace outbit {
+    // Destination of the bytes produced by a BitWriter.
+    class ByteSink {
+        public:
+            virtual ~ByteSink() = default;
+            virtual void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) = 0;
+            virtual void flush(std::source_location = std::source_location::current()) {}
+    };
+
+    // Writes to a file descriptor. The descriptor is not closed by the sink.
+    class FdSink : public ByteSink {
+        public:
+            explicit FdSink(int file_descriptor);
+            void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+
+        private:
+            int m_file_descriptor;
+    };
+
+    // Writes to a C stream. The stream is not closed by the sink.
+    class FileSink : public ByteSink {
+        public:
+            explicit FileSink(std::FILE* file);
+            void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+            void flush(std::source_location = std::source_location::current()) override;
+
+        private:
+            std::FILE* m_file;
+    };
+
+    // Hands every block to a user callback. The bytes are only valid during the call.
+    class CallbackSink : public ByteSink {
+        public:
+            using Callback = std::function<void(std::span<const u8>)>;
+
+            explicit CallbackSink(Callback callback);
+            void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+
+        private:
+            Callback m_callback;
+    };
+
+    // Collects everything in memory. Meant as a stand-in for tests.
+    class MemorySink : public ByteSink {
+        public:
+            void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+            const std::vector<u8>& bytes() const { return m_bytes; }
+
+        private:
+            std::vector<u8> m_bytes;
+    };
+
+    // Writes to a file on a background thread. Bytes are gathered in one of
+    // two buffers; a full buffer is written by the thread while the other
+    // one is filled, so encoding and disk writes overlap. A failed write of
+    // the thread is reported by the next call, and every call after it.
+    //
+    // The destructor closes the file without reporting errors, 'close'
+    // must be called to know that everything was written.
+    class AsyncFileSink : public ByteSink {
+        public:
+            static constexpr std::size_t DEFAULT_BUFFER_SIZE = std::size_t(1) << 20;
+
+            explicit AsyncFileSink(const fs::path& filepath, std::size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                    std::source_location = std::source_location::current());
+            ~AsyncFileSink() override;
+            AsyncFileSink(const AsyncFileSink&) = delete;
+            AsyncFileSink& operator=(const AsyncFileSink&) = delete;
+
+            void write(std::span<const u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+            // Waits until every byte written so far was handed to the file.
+            void flush(std::source_location = std::source_location::current()) override;
+            // Flushes, stops the thread and closes the file.
+            void close(std::source_location = std::source_location::current());
+
+        private:
+            void write_buffers(std::stop_token stop_token);
+            // Hands the buffer being filled to the thread, once the previous one is written.
+            void submit(std::source_location caller_location, std::source_location callee_location);
+            void wait_for_thread(std::unique_lock<std::mutex>& lock, std::source_location caller_location,
+                    std::source_location callee_location);
+            void throw_error(std::string_view reason, std::source_location caller_location,
+                    std::source_location callee_location) const;
+
+            fs::path m_filepath;
+            int m_file_descriptor = -1;
+            std::size_t m_buffer_size;
+            std::array<std::vector<u8>, 2> m_buffers;
+            // Index of the buffer being filled, the other one belongs to the thread while 'm_pending'.
+            std::size_t m_filling = 0;
+
+            std::mutex m_mutex;
+            std::condition_variable_any m_condition;
+            bool m_pending = false;
+            // Reason of the first failed write of the thread.
+            std::string m_error;
+            std::jthread m_thread;
+    };
+
+    // Streaming counterpart of BitBuffer's write side. Completed blocks are
+    // handed to the sink as soon as they fill up, so memory stays bounded by
+    // the block size no matter how long the output is. Bits of an unfinished
+    // byte are kept until 'finish' pads it with zeros.
+    //
+    // The destructor does not flush, 'finish' must be called to emit the tail.
+    template<BitOrder Order>
+    class BasicBitWriter {
+        public:
+            static constexpr std::size_t DEFAULT_BLOCK_SIZE = std::size_t(64) * 1024;
+
+            explicit BasicBitWriter(ByteSink& sink, std::size_t block_size = DEFAULT_BLOCK_SIZE);
+
+            // A write that fills a block hands it to the sink, whose errors
+            // are reported with the location of the write.
+            template<typename T>
+            void write(const T& item, std::source_location = std::source_location::current());
+            template<typename T>
+            void write_bits(const T& item, std::size_t n_bits,
+                    std::source_location = std::source_location::current());
+
+            // Hands every complete byte to the sink, the bits of an
+            // unfinished byte stay in the writer.
+            void flush(std::source_location = std::source_location::current());
+            // Pads the last byte with zeros, hands everything to the sink
+            // and flushes it.
+            void finish(std::source_location = std::source_location::current());
+
+            // Number of bits written so far, including those already flushed.
+            std::size_t written_bits() const;
+
+        private:
+            using Traits = BitOrderTraits<Order>;
+
+            void spill_word(u64 word, std::source_location caller_location);
+            void flush_block(std::source_location);
+
+            ByteSink& m_sink;
+            std::size_t m_block_size;
+            std::vector<u8> m_block;
+            std::size_t m_flushed_bytes = 0;
+            typename Traits::Accumulator m_accumulator;
+    };
+
+    using BitWriter = BasicBitWriter<BitOrder::lsb_first>;
+    // Writes MSB-first streams. Only integral and enum items can be written.
+    using MsbBitWriter = BasicBitWriter<BitOrder::msb_first>;
+
+    // Writes into a span given by the caller and never allocates. A write
+    // that does not fit is rejected as a whole: it returns false, leaves
+    // the written bits as they were and marks the writer as overflowed.
+    //
+    // Every call is constexpr, so tables and headers can be encoded at
+    // compile time into a 'std::array' and embedded in the binary.
+    template<BitOrder Order>
+    class BasicFixedBitWriter {
+        public:
+            constexpr explicit BasicFixedBitWriter(std::span<u8> bytes);
+
+            template<typename T>
+            constexpr bool write(const T& item);
+            template<typename T>
+            constexpr bool write_bits(const T& item, std::size_t n_bits);
+
+            // Pads the last byte with zeros and returns the bytes written.
+            constexpr std::span<u8> finish();
+
+            constexpr std::size_t written_bits() const;
+            constexpr std::size_t capacity_in_bits() const;
+            // Whether any write was rejected.
+            constexpr bool overflowed() const { return m_overflowed; }
+
+        private:
+            using Traits = BitOrderTraits<Order>;
+
+            std::span<u8> m_bytes;
+            // Bytes of 'm_bytes' holding spilled words.
+            std::size_t m_n_bytes = 0;
+            typename Traits::Accumulator m_accumulator;
+            bool m_overflowed = false;
+    };
+
+    using FixedBitWriter = BasicFixedBitWriter<BitOrder::lsb_first>;
+    using MsbFixedBitWriter = BasicFixedBitWriter<BitOrder::msb_first>;
+
+    template<BitOrder Order>
+    template<typename T>
+    void BasicBitWriter<Order>::write(const T& item, const std::source_location caller_location) {
+        this->write_bits(item, sizeof(T) * BYTE_BITS, caller_location);
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    void BasicBitWriter<Order>::write_bits(const T& item, std::size_t n_bits,
+            const std::source_location caller_location) {
+        m_accumulator.push_item(item, n_bits, [this, caller_location](u64 word) {
+            this->spill_word(word, caller_location);
+        });
+    }
+
+    template<BitOrder Order>
+    constexpr BasicFixedBitWriter<Order>::BasicFixedBitWriter(std::span<u8> bytes)
+        : m_bytes(bytes)
+    {
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    constexpr bool BasicFixedBitWriter<Order>::write(const T& item) {
+        return this->write_bits(item, sizeof(T) * BYTE_BITS);
+    }
+
+    template<BitOrder Order>
+    template<typename T>
+    constexpr bool BasicFixedBitWriter<Order>::write_bits(const T& item, std::size_t n_bits) {
+        if (n_bits > this->capacity_in_bits() - this->written_bits()) {
+            m_overflowed = true;
+            return false;
+        }
+
+        // Words only spill once all of their bits fit, so they always fit.
+        m_accumulator.push_item(item, n_bits, [this](u64 word) {
+            auto word_bytes = Traits::store(word);
+            copy_bytes(m_bytes.data() + m_n_bytes, word_bytes.data(), word_bytes.size());
+            m_n_bytes += word_bytes.size();
+        });
+
+        return true;
+    }
+
+    template<BitOrder Order>
+    constexpr std::span<u8> BasicFixedBitWriter<Order>::finish() {
+        auto n_bytes = BitBuffer::constexpr_from_bits_to_bytes_length(m_accumulator.size());
+        if (n_bytes > 0) {
+            auto word_bytes = Traits::store(m_accumulator.bits());
+            copy_bytes(m_bytes.data() + m_n_bytes, word_bytes.data(), n_bytes);
+            m_n_bytes += n_bytes;
+            m_accumulator.clear();
+        }
+
+        return m_bytes.first(m_n_bytes);
+    }
+
+    template<BitOrder Order>
+    constexpr std::size_t BasicFixedBitWriter<Order>::written_bits() const {
+        return m_n_bytes * BYTE_BITS + m_accumulator.size();
+    }
+
+    template<BitOrder Order>
+    constexpr std::size_t BasicFixedBitWriter<Order>::capacity_in_bits() const {
+        return m_bytes.size() * BYTE_BITS;
+    }
+
+    extern template class BasicBitWriter<BitOrder::lsb_first>;
+    extern template class BasicBitWriter<BitOrder::msb_first>;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "BitEngine.hpp"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+
+// Statistics are only collected when the library and its users are built
+// with 'OUTBIT_ENABLE_STATS' defined. Otherwise the counters below are
+// never updated and snapshots are all zeros.
+namespace outbit {
+    namespace fs = std::filesystem;
+
+#ifdef OUTBIT_ENABLE_STATS
+    inline constexpr bool STATS_ENABLED = true;
+#else
+    inline constexpr bool STATS_ENABLED = false;
+#endif
+
+    // Counters of one BitBuffer. Calls are counted per primitive write or
+    // read, so a 'write_exp_golomb' may count as several writes.
+    struct BufferStats {
+        u64 write_calls = 0;
+        u64 written_bits = 0;
+        u64 read_calls = 0;
+        u64 read_bits = 0;
+        // Growths of the byte storage, and bytes moved by them and by the
+        // compactions of 'BufferMode::fifo'.
+        u64 reallocations = 0;
+        u64 copied_bytes = 0;
+        u64 file_reads = 0;
+        u64 file_read_bytes = 0;
+        std::chrono::nanoseconds file_read_time{};
+        u64 file_writes = 0;
+        u64 file_written_bytes = 0;
+        std::chrono::nanoseconds file_write_time{};
+    };
+
+    enum class FileOperation { read, write };
+
+    // Called as the events happen, from the thread using the buffer.
+    struct BufferHooks {
+        std::function<void(std::size_t old_capacity, std::size_t new_capacity)> on_reallocation;
+        std::function<void(FileOperation, const fs::path&, std::size_t n_bytes,
+                std::chrono::nanoseconds)> on_file_io;
+    };
+
+    class StatsRecorder {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            // The current time, or the epoch when statistics are disabled.
+            static Clock::time_point now();
+
+            void count_write(std::size_t n_bits);
+            void count_read(std::size_t n_bits);
+            void count_reallocation(std::size_t old_capacity, std::size_t new_capacity, std::size_t n_copied_bytes);
+            void count_copy(std::size_t n_bytes);
+            void count_file_io(FileOperation operation, const fs::path& filepath, std::size_t n_bytes,
+                    Clock::time_point start);
+
+            BufferStats snapshot() const;
+            void reset();
+            void set_hooks(BufferHooks hooks);
+
+        private:
+            // Present in both configurations, so that the layout of a buffer
+            // does not depend on 'OUTBIT_ENABLE_STATS'.
+            BufferStats m_stats;
+            // Copies of a buffer share the hooks through the pointer.
+            std::shared_ptr<const BufferHooks> m_hooks;
+    };
+
+    inline StatsRecorder::Clock::time_point StatsRecorder::now() {
+        if constexpr (STATS_ENABLED) {
+            return Clock::now();
+        }
+        return {};
+    }
+
+    inline void StatsRecorder::count_write([[maybe_unused]] std::size_t n_bits) {
+        if constexpr (STATS_ENABLED) {
+            m_stats.write_calls++;
+            m_stats.written_bits += n_bits;
+        }
+    }
+
+    inline void StatsRecorder::count_read([[maybe_unused]] std::size_t n_bits) {
+        if constexpr (STATS_ENABLED) {
+            m_stats.read_calls++;
+            m_stats.read_bits += n_bits;
+        }
+    }
+
+    inline void StatsRecorder::count_reallocation([[maybe_unused]] std::size_t old_capacity,
+            [[maybe_unused]] std::size_t new_capacity, [[maybe_unused]] std::size_t n_copied_bytes) {
+        if constexpr (STATS_ENABLED) {
+            m_stats.reallocations++;
+            m_stats.copied_bytes += n_copied_bytes;
+            if (m_hooks && m_hooks->on_reallocation) {
+                m_hooks->on_reallocation(old_capacity, new_capacity);
+            }
+        }
+    }
+
+    inline void StatsRecorder::count_copy([[maybe_unused]] std::size_t n_bytes) {
+        if constexpr (STATS_ENABLED) {
+            m_stats.copied_bytes += n_bytes;
+        }
+    }
+
+    inline void StatsRecorder::count_file_io([[maybe_unused]] FileOperation operation,
+            [[maybe_unused]] const fs::path& filepath, [[maybe_unused]] std::size_t n_bytes,
+            [[maybe_unused]] Clock::time_point start) {
+        if constexpr (STATS_ENABLED) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            if (operation == FileOperation::read) {
+                m_stats.file_reads++;
+                m_stats.file_read_bytes += n_bytes;
+                m_stats.file_read_time += elapsed;
+            } else {
+                m_stats.file_writes++;
+                m_stats.file_written_bytes += n_bytes;
+                m_stats.file_write_time += elapsed;
+            }
+
+            if (m_hooks && m_hooks->on_file_io) {
+                m_hooks->on_file_io(operation, filepath, n_bytes, elapsed);
+            }
+        }
+    }
+
+    inline BufferStats StatsRecorder::snapshot() const {
+        if constexpr (STATS_ENABLED) {
+            return m_stats;
+        }
+        return {};
+    }
+
+    inline void StatsRecorder::reset() {
+        if constexpr (STATS_ENABLED) {
+            m_stats = BufferStats();
+        }
+    }
+
+    inline void StatsRecorder::set_hooks([[maybe_unused]] BufferHooks hooks) {
+        if constexpr (STATS_ENABLED) {
+            m_hooks = std::make_shared<const BufferHooks>(std::move(hooks));
+        }
+    }
+}
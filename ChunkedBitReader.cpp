@@ -0,0 +1,115 @@
+#include "ChunkedBitReader.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace outbit {
+    FdSource::FdSource(int file_descriptor)
+        : m_file_descriptor(file_descriptor)
+    {
+    }
+
+    std::size_t FdSource::read(std::span<u8> bytes, const std::source_location caller_location) {
+        while (true) {
+            auto n_read = ::read(m_file_descriptor, bytes.data(), bytes.size());
+
+            if (n_read >= 0) {
+                return static_cast<std::size_t>(n_read);
+            }
+
+            if (errno != EINTR) {
+                auto callee_location = std::source_location::current();
+                auto erro_msg =
+                    std::format(
+                            "[{}:{}] Method '{}' failed to read from file descriptor {}. {}.",
+                            caller_location.file_name(),
+                            caller_location.line(),
+                            callee_location.function_name(),
+                            m_file_descriptor,
+                            std::strerror(errno));
+
+                throw std::runtime_error(erro_msg);
+            }
+        }
+    }
+
+    CallbackSource::CallbackSource(Callback callback)
+        : m_callback(std::move(callback))
+    {
+    }
+
+    std::size_t CallbackSource::read(std::span<u8> bytes, const std::source_location) {
+        return m_callback(bytes);
+    }
+
+    ChunkedBitReader::ChunkedBitReader(ByteSource& source, std::size_t chunk_size, bool double_buffered)
+        : m_source(source), m_chunk_size{chunk_size}, m_double_buffered{double_buffered}
+    {
+        assert(m_chunk_size > 0);
+
+        m_chunk.resize(CARRY_BYTES + m_chunk_size);
+        m_next_chunk.resize(CARRY_BYTES + m_chunk_size);
+        m_read_window.move_input(CARRY_BYTES);
+    }
+
+    bool ChunkedBitReader::can_read(std::size_t n_bits) {
+        assert(n_bits <= WORD_BITS);
+
+        if (this->buffered_bits() < n_bits) {
+            this->next_chunk();
+        }
+
+        return this->buffered_bits() >= n_bits;
+    }
+
+    std::size_t ChunkedBitReader::tell_bits() const {
+        return m_source_bytes * BYTE_BITS - this->buffered_bits();
+    }
+
+    std::size_t ChunkedBitReader::buffered_bits() const {
+        return m_read_window.window_bits() + (m_chunk_end - m_read_window.next_byte()) * BYTE_BITS;
+    }
+
+    // Reads chunks until a whole word can be loaded or the source is exhausted.
+    void ChunkedBitReader::next_chunk() {
+        while (!m_source_exhausted && m_chunk_end - m_read_window.next_byte() < sizeof(u64)) {
+            std::size_t n_read;
+            if (m_double_buffered) {
+                if (!m_prefetch.valid()) {
+                    m_prefetch = std::async(std::launch::async, [this] {
+                        return this->fill(m_next_chunk);
+                    });
+                }
+
+                n_read = m_prefetch.get();
+            } else {
+                n_read = this->fill(m_next_chunk);
+            }
+
+            if (n_read == 0) {
+                m_source_exhausted = true;
+                break;
+            }
+
+            // Move the bytes not loaded into the window yet in front of the new ones.
+            auto next_byte = m_read_window.next_byte();
+            auto carry = m_chunk_end - next_byte;
+            std::memcpy(m_next_chunk.data() + CARRY_BYTES - carry, m_chunk.data() + next_byte, carry);
+
+            std::swap(m_chunk, m_next_chunk);
+            m_chunk_end = CARRY_BYTES + n_read;
+            m_source_bytes += n_read;
+            m_read_window.move_input(CARRY_BYTES - carry);
+
+            if (m_double_buffered) {
+                m_prefetch = std::async(std::launch::async, [this] {
+                    return this->fill(m_next_chunk);
+                });
+            }
+        }
+    }
+
+    std::size_t ChunkedBitReader::fill(std::vector<u8>& chunk) {
+        return m_source.read(std::span<u8>(chunk).subspan(CARRY_BYTES, m_chunk_size));
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include <functional>
+#include <future>
+
+namespace outbit {
+    // Origin of the bytes decoded by a ChunkedBitReader.
+    class ByteSource {
+        public:
+            virtual ~ByteSource() = default;
+            // Fills the beginning of 'bytes' and returns the number of bytes
+            // read. Returning zero means the source is exhausted.
+            virtual std::size_t read(std::span<u8> bytes,
+                    std::source_location = std::source_location::current()) = 0;
+    };
+
+    // Reads from a file descriptor. The descriptor is not closed by the source.
+    class FdSource : public ByteSource {
+        public:
+            explicit FdSource(int file_descriptor);
+            std::size_t read(std::span<u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+
+        private:
+            int m_file_descriptor;
+    };
+
+    // Asks a user callback to fill the chunks.
+    class CallbackSource : public ByteSource {
+        public:
+            using Callback = std::function<std::size_t(std::span<u8>)>;
+
+            explicit CallbackSource(Callback callback);
+            std::size_t read(std::span<u8> bytes,
+                    std::source_location = std::source_location::current()) override;
+
+        private:
+            Callback m_callback;
+    };
+
+    // Streaming counterpart of BitReader. The input is pulled from a source
+    // one chunk at a time, so arbitrarily long inputs are decoded with a
+    // working set of two chunks. Values may straddle chunk boundaries.
+    //
+    // When double buffered, the next chunk is read on a background thread
+    // while the current one is being decoded.
+    class ChunkedBitReader {
+        public:
+            static const std::size_t DEFAULT_CHUNK_SIZE = std::size_t(64) * 1024;
+
+            explicit ChunkedBitReader(ByteSource& source,
+                    std::size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                    bool double_buffered = false);
+            ChunkedBitReader(const ChunkedBitReader&) = delete;
+            ChunkedBitReader& operator=(const ChunkedBitReader&) = delete;
+
+            template<typename T>
+            T read_as();
+            template<typename T>
+            T read_bits_as(std::size_t n_bits);
+
+            // Whether the next 'n_bits' (at most 64) can be read, pulling
+            // from the source if needed.
+            bool can_read(std::size_t n_bits);
+            // Number of bits read so far, as 'BitBuffer::tell_bits'.
+            std::size_t tell_bits() const;
+
+        private:
+            // Room kept in front of every chunk for the bytes of the
+            // previous chunk that were not loaded into the window yet.
+            static const std::size_t CARRY_BYTES = sizeof(u64);
+
+            inline std::span<const u8> input(std::size_t n_bits);
+            std::size_t buffered_bits() const;
+            void next_chunk();
+            std::size_t fill(std::vector<u8>& chunk);
+
+            ByteSource& m_source;
+            std::size_t m_chunk_size;
+            bool m_double_buffered;
+            bool m_source_exhausted = false;
+            std::size_t m_source_bytes = 0;
+
+            std::vector<u8> m_chunk;
+            std::size_t m_chunk_end = CARRY_BYTES;
+            std::vector<u8> m_next_chunk;
+            // Declared after the chunks, so a pending read is waited for
+            // before they are destroyed.
+            std::future<std::size_t> m_prefetch;
+
+            BitWindow m_read_window;
+    };
+
+    template<typename T>
+    T ChunkedBitReader::read_as() {
+        return this->read_bits_as<T>(sizeof(T) * BYTE_BITS);
+    }
+
+    template<typename T>
+    T ChunkedBitReader::read_bits_as(std::size_t n_bits) {
+        assert(n_bits <= sizeof(T) * BYTE_BITS);
+
+        return m_read_window.read_bits_as<T>(n_bits, [this](std::size_t n_window_bits) {
+            return this->input(n_window_bits);
+        });
+    }
+
+    // Bytes to refill the window from, so it can hand out 'n_bits'.
+    std::span<const u8> ChunkedBitReader::input(std::size_t n_bits) {
+        if (m_read_window.window_bits() < n_bits
+                && m_chunk_end - m_read_window.next_byte() < sizeof(u64)) {
+            this->next_chunk();
+        }
+
+        return std::span<const u8>(m_chunk.data(), m_chunk_end);
+    }
+}
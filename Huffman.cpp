@@ -0,0 +1,218 @@
+#include "Huffman.hpp"
+#include <queue>
+#include <stdexcept>
+
+namespace outbit {
+    namespace {
+        u64 reverse_bits(u64 bits, std::size_t n_bits) {
+            u64 reversed = 0;
+            for (std::size_t index = 0; index < n_bits; index++) {
+                reversed = (reversed << 1) | ((bits >> index) & 1);
+            }
+            return reversed;
+        }
+
+        // Depth of every leaf of a Huffman tree built over 'weights'.
+        std::vector<std::size_t> tree_depths(const std::vector<u64>& weights) {
+            using Node = std::pair<u64, std::size_t>;
+            auto queue = std::priority_queue<Node, std::vector<Node>, std::greater<Node>>();
+            auto parents = std::vector<std::size_t>(weights.size());
+
+            for (std::size_t leaf = 0; leaf < weights.size(); leaf++) {
+                queue.emplace(weights[leaf], leaf);
+            }
+
+            while (queue.size() > 1) {
+                auto [first_weight, first] = queue.top();
+                queue.pop();
+                auto [second_weight, second] = queue.top();
+                queue.pop();
+
+                auto parent = parents.size();
+                parents.push_back(0);
+                parents[first] = parent;
+                parents[second] = parent;
+                queue.emplace(first_weight + second_weight, parent);
+            }
+
+            // Parents are created after their children, so the depths can be
+            // computed from the root down.
+            auto depths = std::vector<std::size_t>(parents.size());
+            for (auto node = parents.size() - 1; node-- > 0;) {
+                depths[node] = depths[parents[node]] + 1;
+            }
+
+            depths.resize(weights.size());
+            return depths;
+        }
+    }
+
+    HuffmanCode HuffmanCode::from_frequencies(std::span<const u64> frequencies, std::size_t max_length) {
+        assert(frequencies.size() <= MAX_SYMBOLS);
+        assert(max_length > 0 && max_length <= MAX_CODE_LENGTH);
+
+        auto code = HuffmanCode();
+        code.m_lengths.assign(frequencies.size(), 0);
+
+        auto symbols = std::vector<std::size_t>();
+        for (std::size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+            if (frequencies[symbol] > 0) {
+                symbols.push_back(symbol);
+            }
+        }
+
+        assert(symbols.size() <= (std::size_t(1) << max_length));
+
+        if (symbols.size() == 1) {
+            code.m_lengths[symbols.front()] = 1;
+        } else if (symbols.size() > 1) {
+            // Most frequent symbols first, they get the shortest codes.
+            std::stable_sort(symbols.begin(), symbols.end(), [&](auto first, auto second) {
+                return frequencies[first] > frequencies[second];
+            });
+
+            auto weights = std::vector<u64>();
+            for (auto symbol : symbols) {
+                weights.push_back(frequencies[symbol]);
+            }
+
+            // Number of codes of every length. Codes longer than 'max_length'
+            // are shortened, then the longest shorter codes are lengthened
+            // one at a time until the lengths describe a prefix code again.
+            auto length_counts = std::vector<std::size_t>(max_length + 1);
+            for (auto depth : tree_depths(weights)) {
+                length_counts[std::min(depth, max_length)]++;
+            }
+
+            u64 kraft_sum = 0;
+            for (std::size_t length = 1; length <= max_length; length++) {
+                kraft_sum += u64(length_counts[length]) << (max_length - length);
+            }
+
+            for (; kraft_sum > (u64(1) << max_length); kraft_sum--) {
+                length_counts[max_length]--;
+                for (auto length = max_length - 1; length > 0; length--) {
+                    if (length_counts[length] > 0) {
+                        length_counts[length]--;
+                        length_counts[length + 1] += 2;
+                        break;
+                    }
+                }
+            }
+
+            auto next = symbols.begin();
+            for (std::size_t length = 1; length <= max_length; length++) {
+                for (std::size_t count = 0; count < length_counts[length]; count++) {
+                    code.m_lengths[*next++] = static_cast<u8>(length);
+                }
+            }
+        }
+
+        code.assign_codes();
+        return code;
+    }
+
+    HuffmanCode HuffmanCode::from_lengths(std::span<const u8> lengths, const std::source_location caller_location) {
+        u64 kraft_sum = 0;
+        for (auto length : lengths) {
+            if (length > 0 && length <= MAX_CODE_LENGTH) {
+                kraft_sum += u64(1) << (MAX_CODE_LENGTH - length);
+            }
+        }
+
+        auto invalid_length = std::find_if(lengths.begin(), lengths.end(), [](auto length) {
+            return length > MAX_CODE_LENGTH;
+        });
+
+        if (lengths.size() > MAX_SYMBOLS || invalid_length != lengths.end()
+                || kraft_sum > (u64(1) << MAX_CODE_LENGTH)) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to build a code from {} lengths. "
+                        "The lengths do not describe a prefix code of at most {} bits.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        lengths.size(),
+                        MAX_CODE_LENGTH);
+
+            throw std::runtime_error(erro_msg);
+        }
+
+        auto code = HuffmanCode();
+        code.m_lengths.assign(lengths.begin(), lengths.end());
+        code.assign_codes();
+        return code;
+    }
+
+    // Codes of the same length are consecutive integers, ordered by symbol,
+    // and follow the codes of the shorter lengths.
+    void HuffmanCode::assign_codes() {
+        m_max_length = 0;
+        auto length_counts = std::array<std::size_t, MAX_CODE_LENGTH + 1>();
+        for (auto length : m_lengths) {
+            length_counts[length]++;
+            m_max_length = std::max<std::size_t>(m_max_length, length);
+        }
+        length_counts[0] = 0;
+
+        auto next_codes = std::array<u64, MAX_CODE_LENGTH + 1>();
+        for (std::size_t length = 1; length <= MAX_CODE_LENGTH; length++) {
+            next_codes[length] = (next_codes[length - 1] + length_counts[length - 1]) << 1;
+        }
+
+        m_codes.assign(m_lengths.size(), 0);
+        for (std::size_t symbol = 0; symbol < m_lengths.size(); symbol++) {
+            auto length = m_lengths[symbol];
+            if (length > 0) {
+                m_codes[symbol] = static_cast<uint16_t>(reverse_bits(next_codes[length]++, length));
+            }
+        }
+    }
+
+    HuffmanDecoder::HuffmanDecoder(const HuffmanCode& code)
+        : m_table(std::size_t(1) << ROOT_BITS),
+        m_peek_bits{std::max(code.max_length(), ROOT_BITS)}
+    {
+        const auto& lengths = code.lengths();
+        const auto& codes = code.codes();
+
+        // Subtables are sized after the longest code sharing their root bits.
+        auto subtable_bits = std::vector<u8>(m_table.size());
+        for (std::size_t symbol = 0; symbol < lengths.size(); symbol++) {
+            if (lengths[symbol] > ROOT_BITS) {
+                auto& bits = subtable_bits[codes[symbol] & low_bits_mask(ROOT_BITS)];
+                bits = std::max(bits, static_cast<u8>(lengths[symbol] - ROOT_BITS));
+            }
+        }
+
+        for (std::size_t root = 0; root < subtable_bits.size(); root++) {
+            if (subtable_bits[root] > 0) {
+                m_table[root] = Entry{ static_cast<uint16_t>(m_table.size()), ROOT_BITS, subtable_bits[root] };
+                m_table.resize(m_table.size() + (std::size_t(1) << subtable_bits[root]));
+            }
+        }
+
+        for (std::size_t symbol = 0; symbol < lengths.size(); symbol++) {
+            std::size_t length = lengths[symbol];
+            if (length == 0) {
+                continue;
+            }
+
+            // Every index whose low bits are the code resolves to the symbol.
+            auto entry = Entry{ static_cast<uint16_t>(symbol), static_cast<u8>(length), 0 };
+            if (length <= ROOT_BITS) {
+                for (u64 index = codes[symbol]; index < (u64(1) << ROOT_BITS); index += u64(1) << length) {
+                    m_table[index] = entry;
+                }
+            } else {
+                auto root = m_table[codes[symbol] & low_bits_mask(ROOT_BITS)];
+                auto step = u64(1) << (length - ROOT_BITS);
+                for (u64 index = codes[symbol] >> ROOT_BITS; index < (u64(1) << root.subtable_bits); index += step) {
+                    m_table[root.value + index] = entry;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include <vector>
+
+// Canonical Huffman coding of symbol streams. Codes are written LSB-first,
+// like every other field of a BitBuffer: the first bit of a code is the
+// lowest bit written, so the decoder indexes its tables with peeked bits
+// directly.
+namespace outbit {
+    // Code lengths and codes of an alphabet of at most 65536 symbols.
+    // Symbols that never occur have no code (length 0).
+    class HuffmanCode {
+        public:
+            static constexpr std::size_t MAX_CODE_LENGTH = 15;
+            static constexpr std::size_t MAX_SYMBOLS = std::size_t(1) << 16;
+
+            HuffmanCode() = default;
+            // Builds a Huffman code whose lengths do not exceed 'max_length'.
+            // It is optimal when no code is longer. Otherwise the long codes
+            // are shortened with a heuristic, which may cost a few bits
+            // more than the optimal length-limited code.
+            static HuffmanCode from_frequencies(std::span<const u64> frequencies,
+                    std::size_t max_length = MAX_CODE_LENGTH);
+            // Rebuilds a code from its lengths alone, as they are stored
+            // next to the encoded data.
+            static HuffmanCode from_lengths(std::span<const u8> lengths,
+                    std::source_location = std::source_location::current());
+
+            const std::vector<u8>& lengths() const { return m_lengths; }
+            // Code of every symbol, in the order its bits are written.
+            const std::vector<uint16_t>& codes() const { return m_codes; }
+            std::size_t max_length() const { return m_max_length; }
+
+            template<typename T>
+            void encode(std::span<const T> symbols, BitBuffer& output) const;
+            inline void encode(std::size_t symbol, BitBuffer& output) const;
+
+        private:
+            void assign_codes();
+
+            std::vector<u8> m_lengths;
+            // Canonical codes, bit-reversed so they can be written LSB-first.
+            std::vector<uint16_t> m_codes;
+            std::size_t m_max_length = 0;
+    };
+
+    // Table-driven decoder. The first 11 bits of a code index a root table,
+    // which resolves every code up to that length in one lookup. Longer
+    // codes are resolved by a second lookup in a subtable, indexed with
+    // the following bits. Only the bits of the decoded code are consumed.
+    class HuffmanDecoder {
+        public:
+            static constexpr std::size_t ROOT_BITS = 11;
+
+            explicit HuffmanDecoder(const HuffmanCode& code);
+
+            inline std::size_t decode(BitBuffer& input) const;
+            template<typename T>
+            void decode(BitBuffer& input, std::span<T> symbols) const;
+
+        private:
+            struct Entry {
+                // Symbol, or offset of the subtable when 'subtable_bits' > 0.
+                uint16_t value = 0;
+                // Length of the code. Zero for bit patterns that are no code.
+                u8 length = 0;
+                u8 subtable_bits = 0;
+            };
+
+            inline static Entry lookup(const Entry* table, u64 bits);
+
+            std::vector<Entry> m_table;
+            std::size_t m_peek_bits;
+    };
+
+    void HuffmanCode::encode(std::size_t symbol, BitBuffer& output) const {
+        assert(symbol < m_lengths.size() && m_lengths[symbol] > 0);
+
+        output.write_bits(m_codes[symbol], m_lengths[symbol]);
+    }
+
+    template<typename T>
+    void HuffmanCode::encode(std::span<const T> symbols, BitBuffer& output) const {
+        static_assert(std::is_integral_v<T>);
+
+        for (auto symbol : symbols) {
+            this->encode(static_cast<std::size_t>(symbol), output);
+        }
+    }
+
+    // Resolves the code starting at the low end of 'bits'.
+    HuffmanDecoder::Entry HuffmanDecoder::lookup(const Entry* table, u64 bits) {
+        auto entry = table[bits & low_bits_mask(ROOT_BITS)];
+        if (entry.subtable_bits > 0) {
+            auto index = (bits >> ROOT_BITS) & low_bits_mask(entry.subtable_bits);
+            entry = table[entry.value + index];
+        }
+
+        // The peeked bits must start a code
+        assert(entry.length > 0);
+
+        return entry;
+    }
+
+    std::size_t HuffmanDecoder::decode(BitBuffer& input) const {
+        auto entry = HuffmanDecoder::lookup(m_table.data(), input.peek_bits(m_peek_bits));
+        input.consume_bits(entry.length);
+        return entry.value;
+    }
+
+    template<typename T>
+    void HuffmanDecoder::decode(BitBuffer& input, std::span<T> symbols) const {
+        static_assert(std::is_integral_v<T>);
+
+        input.read_with([this, symbols](BitWindow& window, std::span<const u8> bytes) {
+            // Locals, so that stores to 'symbols' cannot alias them.
+            auto local_window = window;
+            const auto* table = m_table.data();
+
+            // A refill loads at least 56 bits, enough for this many codes,
+            // so the refill does not depend on the decoded lengths.
+            auto codes_per_refill = (WORD_BITS - BYTE_BITS) / m_peek_bits;
+
+            for (std::size_t index = 0; index < symbols.size();) {
+                local_window.refill(bytes);
+                auto n_codes = local_window.window_bits() >= WORD_BITS - BYTE_BITS ? codes_per_refill : 1;
+                auto end = std::min(symbols.size(), index + n_codes);
+
+                for (; index < end; index++) {
+                    auto entry = HuffmanDecoder::lookup(table, local_window.bits());
+                    local_window.consume_bits(entry.length);
+                    symbols[index] = static_cast<T>(entry.value);
+                }
+            }
+
+            window = local_window;
+        });
+    }
+}
@@ -0,0 +1,124 @@
+#include "IntBlockCodec.hpp"
+#include <limits>
+
+namespace outbit {
+    void IntBlockCodec::encode(std::span<const u64> values, BitBuffer& output) {
+        for (std::size_t offset = 0; offset < values.size(); offset += BLOCK_LENGTH) {
+            IntBlockCodec::encode_block(values.subspan(offset, std::min(BLOCK_LENGTH, values.size() - offset)), output);
+        }
+    }
+
+    void IntBlockCodec::decode(BitBuffer& input, std::span<u64> values) {
+        for (std::size_t offset = 0; offset < values.size(); offset += BLOCK_LENGTH) {
+            IntBlockCodec::decode_block(input, values.subspan(offset, std::min(BLOCK_LENGTH, values.size() - offset)));
+        }
+    }
+
+    void IntBlockCodec::encode_block(std::span<const u64> values, BitBuffer& output) {
+        assert(!values.empty() && values.size() <= BLOCK_LENGTH);
+
+        auto minimum = *std::min_element(values.begin(), values.end());
+        u64 reference_residuals = 0;
+        for (auto value : values) {
+            reference_residuals |= value - minimum;
+        }
+        auto reference_width = static_cast<std::size_t>(std::bit_width(reference_residuals));
+
+        // Differences are compared as signed values, so decreasing runs work too.
+        auto min_delta = std::numeric_limits<int64_t>::max();
+        for (std::size_t index = 1; index < values.size(); index++) {
+            min_delta = std::min(min_delta, static_cast<int64_t>(values[index] - values[index - 1]));
+        }
+        u64 delta_residuals = 0;
+        for (std::size_t index = 1; index < values.size(); index++) {
+            delta_residuals |= values[index] - values[index - 1] - static_cast<u64>(min_delta);
+        }
+        auto delta_width = static_cast<std::size_t>(std::bit_width(delta_residuals));
+
+        auto reference_bits = WORD_BITS + values.size() * reference_width;
+        auto delta_bits = 2 * WORD_BITS + (values.size() - 1) * delta_width;
+
+        auto residuals = std::array<u64, BLOCK_LENGTH>();
+        if (values.size() > 1 && delta_bits < reference_bits) {
+            output.write_bits<1>(static_cast<u8>(Coding::delta));
+            output.write_bits<WIDTH_BITS>(delta_width);
+            output.write_bits<WORD_BITS>(values[0]);
+            output.write_bits<WORD_BITS>(static_cast<u64>(min_delta));
+
+            for (std::size_t index = 1; index < values.size(); index++) {
+                residuals[index - 1] = values[index] - values[index - 1] - static_cast<u64>(min_delta);
+            }
+            IntBlockCodec::write_residuals(std::span(residuals).first(values.size() - 1), delta_width, output);
+        } else {
+            output.write_bits<1>(static_cast<u8>(Coding::frame_of_reference));
+            output.write_bits<WIDTH_BITS>(reference_width);
+            output.write_bits<WORD_BITS>(minimum);
+
+            for (std::size_t index = 0; index < values.size(); index++) {
+                residuals[index] = values[index] - minimum;
+            }
+            IntBlockCodec::write_residuals(std::span(residuals).first(values.size()), reference_width, output);
+        }
+    }
+
+    // Residuals up to 32 bits go through the width-specialized kernels.
+    void IntBlockCodec::write_residuals(std::span<const u64> residuals, std::size_t width, BitBuffer& output) {
+        if (width > MAX_PACKED_WIDTH) {
+            for (auto residual : residuals) {
+                output.write_bits(residual, width);
+            }
+            return;
+        }
+
+        auto narrow = std::array<uint32_t, BLOCK_LENGTH>();
+        std::transform(residuals.begin(), residuals.end(), narrow.begin(), [](u64 residual) {
+            return static_cast<uint32_t>(residual);
+        });
+        output.write_packed(std::span<const uint32_t>(narrow.data(), residuals.size()), width);
+    }
+
+    void IntBlockCodec::decode_block(BitBuffer& input, std::span<u64> values) {
+        assert(!values.empty() && values.size() <= BLOCK_LENGTH);
+
+        auto coding = static_cast<Coding>(input.read_bits<1, u8>());
+        auto width = input.read_bits<WIDTH_BITS, std::size_t>();
+        auto reference = input.read_bits<WORD_BITS, u64>();
+
+        auto n_residuals = values.size();
+        auto min_delta = u64(0);
+        if (coding == Coding::delta) {
+            min_delta = input.read_bits<WORD_BITS, u64>();
+            values[0] = reference;
+            values = values.subspan(1);
+            n_residuals--;
+        }
+
+        if (width > MAX_PACKED_WIDTH) {
+            for (auto& value : values) {
+                value = input.read_bits_as<u64>(width);
+            }
+
+            if (coding == Coding::delta) {
+                for (auto& value : values) {
+                    value = reference += value + min_delta;
+                }
+            } else {
+                for (auto& value : values) {
+                    value += reference;
+                }
+            }
+            return;
+        }
+
+        auto residuals = std::array<uint32_t, BLOCK_LENGTH>();
+        input.read_packed(std::span<uint32_t>(residuals.data(), n_residuals), width);
+
+        if (coding == Coding::delta) {
+            prefix_sum_kernel()(residuals.data(), n_residuals, min_delta, reference, values.data());
+        } else {
+            for (std::size_t index = 0; index < n_residuals; index++) {
+                values[index] = reference + residuals[index];
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+
+namespace outbit {
+    // Bit-packed blocks of 64-bit integers, for sorted or slowly changing
+    // sequences such as timestamps and identifiers. Every block of 128
+    // values is stored with whichever of these takes fewer bits:
+    //
+    //  - frame of reference: the minimum, then 'value - minimum' for every
+    //    value;
+    //  - delta: the first value and the smallest difference between
+    //    consecutive values, then 'difference - smallest' for every other
+    //    value. Constant strides take no bits per value.
+    //
+    // The residuals of a block share the smallest width that fits all of
+    // them, stored in the block header next to the coding.
+    class IntBlockCodec {
+        public:
+            static constexpr std::size_t BLOCK_LENGTH = 128;
+
+            static void encode(std::span<const u64> values, BitBuffer& output);
+            // 'values' must have as many values as were encoded.
+            static void decode(BitBuffer& input, std::span<u64> values);
+
+        private:
+            enum class Coding : u8 { frame_of_reference, delta };
+
+            static constexpr std::size_t WIDTH_BITS = 7;
+
+            static void encode_block(std::span<const u64> values, BitBuffer& output);
+            static void decode_block(BitBuffer& input, std::span<u64> values);
+            static void write_residuals(std::span<const u64> residuals, std::size_t width, BitBuffer& output);
+    };
+}
@@ -0,0 +1,232 @@
+#include "Rans.hpp"
+#include <numeric>
+#include <stdexcept>
+
+namespace outbit {
+    namespace {
+        // States stay in [STATE_LOWER_BOUND, 2^32) between symbols.
+        const u64 STATE_LOWER_BOUND = u64(1) << 16;
+        const std::size_t WORD_LENGTH = 16;
+
+        // 'load_word' for a single renormalization word, on the decoding hot path.
+        uint32_t load_renormalization_word(const u8* bytes) {
+            uint16_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            if constexpr (std::endian::native == std::endian::big) {
+                word = std::byteswap(word);
+            }
+
+            return word;
+        }
+    }
+
+    RansCode RansCode::from_frequencies(std::span<const u64> frequencies) {
+        assert(frequencies.size() <= MAX_SYMBOLS);
+
+        auto code = RansCode();
+        code.m_frequencies.assign(frequencies.size(), 0);
+
+        auto total = std::accumulate(frequencies.begin(), frequencies.end(), u64(0));
+        if (total == 0) {
+            code.assign_starts();
+            return code;
+        }
+
+        std::size_t scaled_total = 0;
+        for (std::size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+            if (frequencies[symbol] > 0) {
+                auto scaled = static_cast<double>(frequencies[symbol]) * PROB_SCALE / static_cast<double>(total);
+                code.m_frequencies[symbol] = static_cast<uint16_t>(std::max(1.0, scaled));
+                scaled_total += code.m_frequencies[symbol];
+            }
+        }
+
+        // Rounding and the minimum of 1 move the sum away from PROB_SCALE.
+        // The difference is taken from, or given to, the most frequent
+        // symbols, where it costs the least.
+        auto& frequent = code.m_frequencies;
+        while (scaled_total != PROB_SCALE) {
+            auto most_frequent = std::max_element(frequent.begin(), frequent.end());
+            if (scaled_total < PROB_SCALE) {
+                *most_frequent += static_cast<uint16_t>(PROB_SCALE - scaled_total);
+                scaled_total = PROB_SCALE;
+                continue;
+            }
+
+            auto excess = scaled_total - PROB_SCALE;
+            auto taken = std::min<std::size_t>(excess, std::max<std::size_t>(*most_frequent / 2, 1));
+            *most_frequent -= static_cast<uint16_t>(taken);
+            scaled_total -= taken;
+        }
+
+        code.assign_starts();
+        return code;
+    }
+
+    RansCode RansCode::from_scaled_frequencies(std::span<const uint16_t> frequencies,
+            const std::source_location caller_location) {
+        auto total = std::accumulate(frequencies.begin(), frequencies.end(), std::size_t(0));
+        if (frequencies.size() > MAX_SYMBOLS || total != PROB_SCALE) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to build a code from {} frequencies. "
+                        "They must be at most {} and sum up to {}, not {}.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        frequencies.size(),
+                        MAX_SYMBOLS,
+                        PROB_SCALE,
+                        total);
+
+            throw std::runtime_error(erro_msg);
+        }
+
+        auto code = RansCode();
+        code.m_frequencies.assign(frequencies.begin(), frequencies.end());
+        code.assign_starts();
+        return code;
+    }
+
+    void RansCode::assign_starts() {
+        m_starts.assign(m_frequencies.size(), 0);
+        std::size_t start = 0;
+        for (std::size_t symbol = 0; symbol < m_frequencies.size(); symbol++) {
+            m_starts[symbol] = static_cast<uint16_t>(start);
+            start += m_frequencies[symbol];
+        }
+    }
+
+    // The symbols are encoded from the last one, so that the decoder reads
+    // them from the first one. The words are collected and written in
+    // reverse order once all symbols are encoded.
+    void RansCode::encode(std::span<const u8> symbols, BitBuffer& output) const {
+        auto states = std::array<u64, N_STATES>();
+        states.fill(STATE_LOWER_BOUND);
+
+        auto words = std::vector<uint16_t>();
+        words.reserve(symbols.size() / 2 + N_STATES);
+
+        for (auto index = symbols.size(); index-- > 0;) {
+            auto symbol = symbols[index];
+            auto& state = states[index % N_STATES];
+
+            assert(symbol < m_frequencies.size() && m_frequencies[symbol] > 0);
+            u64 frequency = m_frequencies[symbol];
+
+            // Keeps the next state below 2^32.
+            auto state_limit = ((STATE_LOWER_BOUND >> PROB_BITS) << WORD_LENGTH) * frequency;
+            if (state >= state_limit) {
+                words.push_back(static_cast<uint16_t>(state));
+                state >>= WORD_LENGTH;
+            }
+
+            state = ((state / frequency) << PROB_BITS) + state % frequency + m_starts[symbol];
+        }
+
+        // Byte aligned, so the decoder reads the words straight from the bytes.
+        output.write_bits(u8(0), (BYTE_BITS - output.size_in_bits() % BYTE_BITS) % BYTE_BITS);
+        for (auto state : states) {
+            output.write_bits<32>(static_cast<uint32_t>(state));
+        }
+
+        std::reverse(words.begin(), words.end());
+        output.write_packed(std::span<const uint16_t>(words), WORD_LENGTH);
+    }
+
+    RansDecoder::RansDecoder(const RansCode& code)
+        : m_slots(RansCode::PROB_SCALE)
+    {
+        const auto& frequencies = code.frequencies();
+        const auto& starts = code.starts();
+        for (std::size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+            for (std::size_t offset = 0; offset < frequencies[symbol]; offset++) {
+                m_slots[starts[symbol] + offset] = RansDecoder::make_slot(frequencies[symbol], offset, symbol);
+            }
+        }
+    }
+
+    RansDecoder::Slot RansDecoder::make_slot(std::size_t frequency, std::size_t offset, std::size_t symbol) {
+        assert(frequency >= 1 && frequency <= RansCode::PROB_SCALE && offset < frequency && symbol < RansCode::MAX_SYMBOLS);
+
+        return static_cast<Slot>((frequency - 1) | (offset << 12) | (symbol << 24));
+    }
+
+    void RansDecoder::decode(BitBuffer& input, std::span<u8> symbols) const {
+        input.skip_bits((BYTE_BITS - input.tell_bits() % BYTE_BITS) % BYTE_BITS);
+
+        auto states = std::array<uint32_t, RansCode::N_STATES>();
+        for (auto& state : states) {
+            state = input.read_bits<32, uint32_t>();
+        }
+
+        input.read_with([this, symbols, &states](BitWindow& window, std::span<const u8> bytes) {
+            // Locals, so that stores to 'symbols' cannot alias them.
+            auto local_states = states;
+            const auto* slots = m_slots.data();
+
+            // The words are byte aligned and read without the window.
+            assert(window.position() % BYTE_BITS == 0);
+            const auto* next_word = bytes.data() + window.position() / BYTE_BITS;
+            const auto* end = bytes.data() + bytes.size();
+
+            auto decode_symbol = [&](uint32_t& state) {
+                auto slot = slots[state & (RansCode::PROB_SCALE - 1)];
+                state = RansDecoder::frequency(slot) * (state >> RansCode::PROB_BITS) + RansDecoder::offset(slot);
+                if (state < STATE_LOWER_BOUND) {
+                    assert(next_word + sizeof(uint16_t) <= end);
+                    state = (state << WORD_LENGTH) | load_renormalization_word(next_word);
+                    next_word += sizeof(uint16_t);
+                }
+
+                return RansDecoder::symbol(slot);
+            };
+
+            // Whether a state renormalizes is close to random, so away from
+            // the end of the input a word is always loaded and only kept
+            // when needed, without a branch.
+            auto decode_symbol_branchless = [&](uint32_t& state) {
+                auto slot = slots[state & (RansCode::PROB_SCALE - 1)];
+                state = RansDecoder::frequency(slot) * (state >> RansCode::PROB_BITS) + RansDecoder::offset(slot);
+
+                auto word = load_renormalization_word(next_word);
+                auto renormalize = state < STATE_LOWER_BOUND;
+                state = renormalize ? (state << WORD_LENGTH) | word : state;
+                next_word += renormalize ? sizeof(uint16_t) : 0;
+
+                return RansDecoder::symbol(slot);
+            };
+
+            static_assert(RansCode::N_STATES == 4);
+            const auto group_bytes = RansCode::N_STATES * sizeof(uint16_t);
+            std::size_t index = 0;
+            for (; index + RansCode::N_STATES <= symbols.size()
+                    && static_cast<std::size_t>(end - next_word) >= group_bytes; index += RansCode::N_STATES) {
+                symbols[index] = decode_symbol_branchless(local_states[0]);
+                symbols[index + 1] = decode_symbol_branchless(local_states[1]);
+                symbols[index + 2] = decode_symbol_branchless(local_states[2]);
+                symbols[index + 3] = decode_symbol_branchless(local_states[3]);
+            }
+
+            for (; index + RansCode::N_STATES <= symbols.size(); index += RansCode::N_STATES) {
+                symbols[index] = decode_symbol(local_states[0]);
+                symbols[index + 1] = decode_symbol(local_states[1]);
+                symbols[index + 2] = decode_symbol(local_states[2]);
+                symbols[index + 3] = decode_symbol(local_states[3]);
+            }
+
+            for (; index < symbols.size(); index++) {
+                symbols[index] = decode_symbol(local_states[index % RansCode::N_STATES]);
+            }
+
+            window.seek(bytes, static_cast<std::size_t>(next_word - bytes.data()) * BYTE_BITS);
+            states = local_states;
+        });
+
+        // Decoding undoes every step of the encoder, back to its initial states
+        for ([[maybe_unused]] auto state : states) {
+            assert(state == STATE_LOWER_BOUND);
+        }
+    }
+}
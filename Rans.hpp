@@ -0,0 +1,71 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include <vector>
+
+// Range asymmetric numeral system (rANS) coding of byte streams. It gets
+// within a fraction of a percent of the entropy, also on the skewed
+// distributions where a Huffman code needs a whole bit per symbol.
+//
+// Four coder states are interleaved, symbol 'i' going through state
+// 'i % 4', so that the decoder works on four independent dependency
+// chains. The states renormalize by 16-bit words, all of them in a single
+// stream of the BitBuffer:
+//
+//     padding       zeros up to the next byte boundary
+//     4 x 32 bits   final states of the encoder
+//     16-bit words  in the order the decoder reads them
+namespace outbit {
+    // Frequencies of a byte alphabet, scaled to sum up to 2^PROB_BITS.
+    // Symbols that never occur have a zero frequency.
+    class RansCode {
+        public:
+            static constexpr std::size_t PROB_BITS = 12;
+            static constexpr std::size_t PROB_SCALE = std::size_t(1) << PROB_BITS;
+            static constexpr std::size_t MAX_SYMBOLS = 256;
+            static constexpr std::size_t N_STATES = 4;
+
+            RansCode() = default;
+            // Every symbol that occurs keeps a frequency of at least 1.
+            static RansCode from_frequencies(std::span<const u64> frequencies);
+            // Rebuilds a code from its scaled frequencies, as they are stored
+            // next to the encoded data.
+            static RansCode from_scaled_frequencies(std::span<const uint16_t> frequencies,
+                    std::source_location = std::source_location::current());
+
+            const std::vector<uint16_t>& frequencies() const { return m_frequencies; }
+            // Sum of the frequencies of the symbols below every symbol.
+            const std::vector<uint16_t>& starts() const { return m_starts; }
+
+            // Every symbol must have a non-zero frequency.
+            void encode(std::span<const u8> symbols, BitBuffer& output) const;
+
+        private:
+            void assign_starts();
+
+            std::vector<uint16_t> m_frequencies;
+            std::vector<uint16_t> m_starts;
+    };
+
+    // Table-driven decoder: the low PROB_BITS of a state index a table of
+    // the symbol, frequency and start of every slot.
+    class RansDecoder {
+        public:
+            explicit RansDecoder(const RansCode& code);
+
+            // 'symbols' must have as many symbols as were encoded.
+            void decode(BitBuffer& input, std::span<u8> symbols) const;
+
+        private:
+            // Frequency minus one, the distance of the slot from the start
+            // of its symbol and the symbol, in 12, 12 and 8 bits.
+            using Slot = uint32_t;
+
+            static Slot make_slot(std::size_t frequency, std::size_t offset, std::size_t symbol);
+            static uint32_t frequency(Slot slot) { return (slot & 0xfff) + 1; }
+            static uint32_t offset(Slot slot) { return (slot >> 12) & 0xfff; }
+            static u8 symbol(Slot slot) { return static_cast<u8>(slot >> 24); }
+
+            std::vector<Slot> m_slots;
+    };
+}
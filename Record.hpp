@@ -0,0 +1,158 @@
+#pragma once
+
+#include "BitEngine.hpp"
+#include <tuple>
+#include <utility>
+
+// Compile-time description of how a struct is stored: a list of members
+// with the number of bits kept for each of them. The layout is the one of
+// consecutive 'write_bits' calls, in the order of the fields, and every
+// offset and mask is a constant, so packing a record takes no branches.
+//
+//     using TelemetrySchema = outbit::Schema<
+//         outbit::Field<&Telemetry::timestamp, 34>,
+//         outbit::Field<&Telemetry::temperature, 11>>;
+namespace outbit {
+    template<typename>
+    struct MemberPointer;
+
+    template<typename R, typename M>
+    struct MemberPointer<M R::*> {
+        using record_type = R;
+        using value_type = M;
+    };
+
+    // Keeps the 'Width' low bits of a member. Signed members are sign
+    // extended when read back, floating point members must keep all bits.
+    template<auto Member, std::size_t Width>
+    struct Field {
+        using record_type = typename MemberPointer<decltype(Member)>::record_type;
+        using value_type = typename MemberPointer<decltype(Member)>::value_type;
+
+        static constexpr std::size_t width = Width;
+
+        static_assert(Width > 0 && Width <= WORD_BITS && Width <= sizeof(value_type) * BYTE_BITS,
+                "Invalid 'Width'. It must fit the member and a 64-bit word.");
+        static_assert(std::is_integral_v<value_type> || std::is_enum_v<value_type>
+                || (std::is_floating_point_v<value_type> && Width == sizeof(value_type) * BYTE_BITS),
+                "Only integral, enum and full-width floating point members can be fields.");
+
+        static constexpr u64 get(const record_type& record);
+        static constexpr void set(record_type& record, u64 bits);
+    };
+
+    template<typename... Fields>
+    class Schema {
+        public:
+            static_assert(sizeof...(Fields) > 0);
+
+            using record_type = typename std::tuple_element_t<0, std::tuple<Fields...>>::record_type;
+            static_assert((std::is_same_v<record_type, typename Fields::record_type> && ...),
+                    "The fields of a schema must belong to the same struct.");
+
+            static constexpr std::size_t size_in_bits = (Fields::width + ...);
+            static constexpr std::size_t n_words = (size_in_bits + WORD_BITS - 1) / WORD_BITS;
+            // Bits used in the last word.
+            static constexpr std::size_t tail_bits = size_in_bits - (n_words - 1) * WORD_BITS;
+
+            using Words = std::array<u64, n_words>;
+
+            static constexpr Words pack(const record_type& record);
+            static constexpr record_type unpack(const Words& words);
+
+        private:
+            static constexpr std::array<std::size_t, sizeof...(Fields)> offsets = [] {
+                auto widths = std::array<std::size_t, sizeof...(Fields)>{ Fields::width... };
+                auto field_offsets = std::array<std::size_t, sizeof...(Fields)>();
+                std::size_t offset = 0;
+                for (std::size_t index = 0; index < widths.size(); index++) {
+                    field_offsets[index] = offset;
+                    offset += widths[index];
+                }
+                return field_offsets;
+            }();
+
+            template<std::size_t I, typename F>
+            static constexpr void pack_field(const record_type& record, Words& words);
+            template<std::size_t I, typename F>
+            static constexpr void unpack_field(const Words& words, record_type& record);
+    };
+
+    template<auto Member, std::size_t Width>
+    constexpr u64 Field<Member, Width>::get(const record_type& record) {
+        const auto& value = record.*Member;
+
+        u64 bits;
+        if constexpr (std::is_floating_point_v<value_type>) {
+            bits = static_cast<u64>(std::bit_cast<std::conditional_t<sizeof(value_type) == sizeof(u64), u64, uint32_t>>(value));
+        } else {
+            bits = static_cast<u64>(value);
+        }
+
+        return bits & low_bits_mask(Width);
+    }
+
+    template<auto Member, std::size_t Width>
+    constexpr void Field<Member, Width>::set(record_type& record, u64 bits) {
+        auto& value = record.*Member;
+
+        if constexpr (std::is_floating_point_v<value_type>) {
+            using Bits = std::conditional_t<sizeof(value_type) == sizeof(u64), u64, uint32_t>;
+            value = std::bit_cast<value_type>(static_cast<Bits>(bits));
+        } else if constexpr (std::is_signed_v<value_type> && Width < WORD_BITS) {
+            // Sign extension of the stored bits.
+            const u64 sign_bit = u64(1) << (Width - 1);
+            value = static_cast<value_type>(static_cast<int64_t>((bits ^ sign_bit) - sign_bit));
+        } else {
+            value = static_cast<value_type>(bits);
+        }
+    }
+
+    template<typename... Fields>
+    constexpr auto Schema<Fields...>::pack(const record_type& record) -> Words {
+        auto words = Words{};
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (Schema::pack_field<I, Fields>(record, words), ...);
+        }(std::index_sequence_for<Fields...>{});
+
+        return words;
+    }
+
+    template<typename... Fields>
+    constexpr auto Schema<Fields...>::unpack(const Words& words) -> record_type {
+        auto record = record_type{};
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (Schema::unpack_field<I, Fields>(words, record), ...);
+        }(std::index_sequence_for<Fields...>{});
+
+        return record;
+    }
+
+    template<typename... Fields>
+    template<std::size_t I, typename F>
+    constexpr void Schema<Fields...>::pack_field(const record_type& record, Words& words) {
+        constexpr auto word = offsets[I] / WORD_BITS;
+        constexpr auto shift = offsets[I] % WORD_BITS;
+
+        auto bits = F::get(record);
+        words[word] |= bits << shift;
+        // Fields may straddle two words.
+        if constexpr (shift + F::width > WORD_BITS) {
+            words[word + 1] |= bits >> (WORD_BITS - shift);
+        }
+    }
+
+    template<typename... Fields>
+    template<std::size_t I, typename F>
+    constexpr void Schema<Fields...>::unpack_field(const Words& words, record_type& record) {
+        constexpr auto word = offsets[I] / WORD_BITS;
+        constexpr auto shift = offsets[I] % WORD_BITS;
+
+        auto bits = words[word] >> shift;
+        if constexpr (shift + F::width > WORD_BITS) {
+            bits |= words[word + 1] << (WORD_BITS - shift);
+        }
+
+        F::set(record, bits & low_bits_mask(F::width));
+    }
+}
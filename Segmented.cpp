@@ -0,0 +1,161 @@
+#include "Segmented.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace outbit {
+    SegmentedCodec::SegmentedCodec(std::size_t n_threads)
+        : m_n_threads{n_threads}
+    {
+        if (m_n_threads == 0) {
+            m_n_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (std::size_t worker = 1; worker < m_n_threads; worker++) {
+            m_workers.emplace_back([this](std::stop_token stop_token) {
+                this->work(stop_token);
+            });
+        }
+    }
+
+    void SegmentedCodec::work(std::stop_token stop_token) const {
+        std::size_t generation = 0;
+
+        auto lock = std::unique_lock(m_mutex);
+        while (m_condition.wait(lock, stop_token, [&] { return m_generation != generation; })) {
+            generation = m_generation;
+            lock.unlock();
+
+            this->run_tasks(m_batch);
+
+            lock.lock();
+            if (--m_n_busy == 0) {
+                m_condition.notify_all();
+            }
+        }
+    }
+
+    void SegmentedCodec::run_tasks(Batch& batch) const {
+        for (auto index = batch.next_task++; index < batch.n_tasks; index = batch.next_task++) {
+            try {
+                (*batch.task)(index);
+            } catch (...) {
+                auto lock = std::scoped_lock(m_mutex);
+                if (!batch.error) {
+                    batch.error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void SegmentedCodec::parallel_for(std::size_t n_tasks, const Task& task) const {
+        auto batch_lock = std::unique_lock(m_batch_mutex, std::try_to_lock);
+        if (!batch_lock || m_workers.empty() || n_tasks <= 1) {
+            auto batch = Batch();
+            batch.task = &task;
+            batch.n_tasks = n_tasks;
+            this->run_tasks(batch);
+            if (batch.error) {
+                std::rethrow_exception(batch.error);
+            }
+
+            return;
+        }
+
+        {
+            auto lock = std::scoped_lock(m_mutex);
+            m_batch.task = &task;
+            m_batch.n_tasks = n_tasks;
+            m_batch.next_task = 0;
+            m_batch.error = nullptr;
+            m_n_busy = m_workers.size();
+            m_generation++;
+        }
+        m_condition.notify_all();
+
+        // The calling thread works too.
+        this->run_tasks(m_batch);
+
+        auto lock = std::unique_lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_n_busy == 0; });
+        if (m_batch.error) {
+            std::rethrow_exception(std::exchange(m_batch.error, nullptr));
+        }
+    }
+
+    BitBuffer SegmentedCodec::encode(std::size_t n_segments, const Encoder& encode_segment) const {
+        auto segments = std::vector<BitBuffer>(n_segments);
+        this->parallel_for(n_segments, [&](std::size_t segment) {
+            encode_segment(segment, segments[segment]);
+        });
+
+        std::size_t n_bytes = (1 + n_segments) * sizeof(u64);
+        for (auto& segment : segments) {
+            n_bytes += segment.buffer().size();
+        }
+
+        // The index is whole words, so the segments are copied at once.
+        auto output = BitBuffer();
+        output.reserve(n_bytes);
+        output.write(u64(n_segments));
+        for (auto& segment : segments) {
+            output.write(u64(segment.size_in_bits()));
+        }
+        for (auto& segment : segments) {
+            output.write_bytes(segment.buffer());
+        }
+
+        return output;
+    }
+
+    std::size_t SegmentedCodec::decode(std::span<const u8> bytes, const Decoder& decode_segment,
+            const std::source_location caller_location) const {
+        auto index_error = [&](std::string_view reason) {
+            auto callee_location = std::source_location::current();
+            auto erro_msg =
+                std::format(
+                        "[{}:{}] Method '{}' failed to read the segment index. {}.",
+                        caller_location.file_name(),
+                        caller_location.line(),
+                        callee_location.function_name(),
+                        reason);
+
+            return std::runtime_error(erro_msg);
+        };
+
+        auto reader = BitReader(bytes);
+        if (reader.remaining_bits() < WORD_BITS) {
+            throw index_error("The input is too short");
+        }
+
+        auto n_segments = reader.read_as<u64>();
+        if (n_segments > reader.remaining_bits() / WORD_BITS) {
+            throw index_error("The input is too short for its index");
+        }
+
+        // Byte offset of every segment, and of the end of the last one.
+        auto offsets = std::vector<std::size_t>(n_segments + 1);
+        offsets[0] = (1 + n_segments) * sizeof(u64);
+        for (std::size_t segment = 0; segment < n_segments; segment++) {
+            auto n_bits = reader.read_as<u64>();
+            auto n_segment_bytes = BitBuffer::from_bits_to_bytes_length(n_bits);
+            if (n_bits > bytes.size() * BYTE_BITS || n_segment_bytes > bytes.size() - offsets[segment]) {
+                throw index_error(std::format("Segment {} ends past the input", segment));
+            }
+
+            offsets[segment + 1] = offsets[segment] + n_segment_bytes;
+        }
+
+        this->parallel_for(n_segments, [&](std::size_t segment) {
+            auto segment_bytes = bytes.subspan(offsets[segment], offsets[segment + 1] - offsets[segment]);
+            auto segment_reader = BitReader(segment_bytes);
+            decode_segment(segment, segment_reader);
+        });
+
+        return n_segments;
+    }
+
+    std::size_t SegmentedCodec::decode(BitBuffer& input, const Decoder& decode_segment,
+            const std::source_location caller_location) const {
+        return this->decode(input.bytes(), decode_segment, caller_location);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "BitBuffer.hpp"
+#include "BitReader.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace outbit {
+    // Splits an encoding into independent bit streams, the segments, that
+    // are encoded and decoded on several threads. The segments are stored
+    // one after another, each starting at a byte boundary, behind an index:
+    //
+    //     u64 number of segments
+    //     u64 length in bits of every segment
+    //     bytes of every segment
+    //
+    // The words are little-endian, as written by 'BitBuffer::write'. The
+    // output only depends on what the callbacks write, not on the number
+    // of threads.
+    class SegmentedCodec {
+        public:
+            // Writes segment 'segment' into the empty buffer 'output'.
+            using Encoder = std::function<void(std::size_t segment, BitBuffer& output)>;
+            // Reads segment 'segment' from 'input', a view over its bytes.
+            using Decoder = std::function<void(std::size_t segment, BitReader& input)>;
+
+            // Zero uses one thread per hardware thread. The threads are
+            // started here and kept until the codec is destroyed.
+            explicit SegmentedCodec(std::size_t n_threads = 0);
+            SegmentedCodec(const SegmentedCodec&) = delete;
+            SegmentedCodec& operator=(const SegmentedCodec&) = delete;
+
+            BitBuffer encode(std::size_t n_segments, const Encoder& encode_segment) const;
+            // Returns the number of segments, after all of them were decoded.
+            std::size_t decode(std::span<const u8> bytes, const Decoder& decode_segment,
+                    std::source_location = std::source_location::current()) const;
+            std::size_t decode(BitBuffer& input, const Decoder& decode_segment,
+                    std::source_location = std::source_location::current()) const;
+
+            std::size_t n_threads() const { return m_n_threads; }
+
+        private:
+            using Task = std::function<void(std::size_t)>;
+
+            // Tasks of one 'parallel_for' call.
+            struct Batch {
+                const Task* task = nullptr;
+                std::size_t n_tasks = 0;
+                std::atomic<std::size_t> next_task = 0;
+                // First exception thrown by a task.
+                std::exception_ptr error;
+            };
+
+            // Runs 'task' for every index below 'n_tasks' on up to
+            // 'm_n_threads' threads. The first exception thrown is rethrown.
+            void parallel_for(std::size_t n_tasks, const Task& task) const;
+            // Runs tasks of 'batch' until none is left.
+            void run_tasks(Batch& batch) const;
+            void work(std::stop_token stop_token) const;
+
+            std::size_t m_n_threads;
+            // One batch runs on the workers at a time. A call made meanwhile,
+            // such as one from a task, runs its tasks on its own thread.
+            mutable std::mutex m_batch_mutex;
+
+            mutable std::mutex m_mutex;
+            mutable std::condition_variable_any m_condition;
+            mutable Batch m_batch;
+            // Incremented for every batch, so every worker joins it once.
+            mutable std::size_t m_generation = 0;
+            // Workers that did not finish the current batch yet.
+            mutable std::size_t m_n_busy = 0;
+            // The calling thread works too, so there is one worker less
+            // than 'm_n_threads'. Last, so they stop before the rest goes.
+            std::vector<std::jthread> m_workers;
+    };
+}
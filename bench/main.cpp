@@ -0,0 +1,827 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <BitBuffer.hpp>
+#include <BitReader.hpp>
+#include <BitWriter.hpp>
+#include <Huffman.hpp>
+#include <Rans.hpp>
+#include <IntBlockCodec.hpp>
+#include <BitVector.hpp>
+#include <BitChannel.hpp>
+
+using namespace outbit;
+
+// Benchmarks of the BitBuffer hot paths. Every scenario is run a few times
+// and the fastest run is reported, one CSV line per scenario:
+//
+//     name,bytes,ops,seconds,mb_per_s,ns_per_op
+//
+// 'bytes' is the size of the encoded bits moved by one run and 'ops' the
+// number of calls made on the buffer. Usage: ./run.out [filter] [scale]
+// runs the scenarios whose name contains 'filter', with 'scale' times
+// the default amount of work.
+
+namespace {
+    // Keeps the values read from being optimized away.
+    volatile u64 g_checksum = 0;
+
+    struct Result {
+        std::size_t bytes;
+        std::size_t ops;
+    };
+
+    struct Scenario {
+        std::string_view name;
+        std::function<Result(std::size_t scale)> run;
+    };
+
+    const int N_RUNS = 5;
+    const std::size_t N_ITEMS = std::size_t(1) << 22;
+    const std::size_t FILE_BYTES = std::size_t(64) << 20;
+    const char* const BENCH_FILE = "bench_file.bin";
+
+    struct Record {
+        uint32_t id;
+        uint16_t kind;
+        uint8_t flags;
+        uint8_t level;
+        double value;
+    };
+
+    using RecordSchema = Schema<
+        Field<&Record::id, 22>,
+        Field<&Record::kind, 10>,
+        Field<&Record::flags, 3>,
+        Field<&Record::level, 4>,
+        Field<&Record::value, 64>>;
+
+    // Widths between 1 and 64, drawn once so every run encodes the same bits.
+    const std::vector<u8>& random_widths() {
+        static const auto widths = [] {
+            auto generator = std::mt19937_64(42);
+            auto distribution = std::uniform_int_distribution<int>(1, 64);
+            auto drawn = std::vector<u8>(N_ITEMS);
+            for (auto& width : drawn) {
+                width = static_cast<u8>(distribution(generator));
+            }
+            return drawn;
+        }();
+
+        return widths;
+    }
+
+    std::size_t total_bits(const std::vector<u8>& widths, std::size_t scale) {
+        std::size_t n_bits = 0;
+        for (std::size_t index = 0; index < N_ITEMS * scale; index++) {
+            n_bits += widths[index % widths.size()];
+        }
+        return n_bits;
+    }
+
+    BitBuffer filled_with_fixed_width(std::size_t width, std::size_t n_items) {
+        auto bitbuffer = BitBuffer();
+        bitbuffer.reserve(BitBuffer::from_bits_to_bytes_length(width * n_items));
+        for (std::size_t index = 0; index < n_items; index++) {
+            bitbuffer.write_bits(index, width);
+        }
+        return bitbuffer;
+    }
+
+    Result write_bits_fixed(std::size_t scale) {
+        const std::size_t width = 13;
+        auto n_items = N_ITEMS * scale;
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t index = 0; index < n_items; index++) {
+            bitbuffer.write_bits(index, width);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { BitBuffer::from_bits_to_bytes_length(width * n_items), n_items };
+    }
+
+    Result write_bits_random(std::size_t scale) {
+        const auto& widths = random_widths();
+        auto n_items = N_ITEMS * scale;
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t index = 0; index < n_items; index++) {
+            bitbuffer.write_bits(index * 0x9e3779b97f4a7c15, widths[index % widths.size()]);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { BitBuffer::from_bits_to_bytes_length(total_bits(widths, scale)), n_items };
+    }
+
+    Result read_bits_fixed(std::size_t scale) {
+        const std::size_t width = 13;
+        auto n_items = N_ITEMS * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = filled_with_fixed_width(width, n_items);
+            filled_scale = scale;
+        }
+
+        // Rewinds the read position.
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += bitbuffer.read_bits_as<uint16_t>(width);
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { BitBuffer::from_bits_to_bytes_length(width * n_items), n_items };
+    }
+
+    Result read_bits_random(std::size_t scale) {
+        const auto& widths = random_widths();
+        auto n_items = N_ITEMS * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitbuffer.write_bits(index * 0x9e3779b97f4a7c15, widths[index % widths.size()]);
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += bitbuffer.read_bits_as<uint64_t>(widths[index % widths.size()]);
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { BitBuffer::from_bits_to_bytes_length(total_bits(widths, scale)), n_items };
+    }
+
+    // The random widths of 'read_bits_as_random', in a stream of bit order 'Order'.
+    template<BitOrder Order>
+    Result read_random_span(std::size_t scale) {
+        const auto& widths = random_widths();
+        auto n_items = N_ITEMS * scale;
+        auto n_bytes = BitBuffer::from_bits_to_bytes_length(total_bits(widths, scale));
+
+        static auto bytes = std::vector<u8>();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bytes.assign(n_bytes, 0);
+            auto writer = BasicFixedBitWriter<Order>(bytes);
+            for (std::size_t index = 0; index < n_items; index++) {
+                writer.write_bits(index * 0x9e3779b97f4a7c15, widths[index % widths.size()]);
+            }
+            writer.finish();
+            filled_scale = scale;
+        }
+
+        auto reader = BasicBitReader<Order>(std::span<const u8>(bytes));
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += reader.template read_bits_as<uint64_t>(widths[index % widths.size()]);
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { n_bytes, n_items };
+    }
+
+    Result write_struct(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t index = 0; index < n_items; index++) {
+            auto record = Record{ uint32_t(index), uint16_t(index >> 3), 0, 7, double(index) };
+            bitbuffer.write(record);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { n_items * sizeof(Record), n_items };
+    }
+
+    Result read_struct(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitbuffer.write(Record{ uint32_t(index), uint16_t(index >> 3), 0, 7, double(index) });
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += bitbuffer.read_as<Record>().id;
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { n_items * sizeof(Record), n_items };
+    }
+
+    Result write_record(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t index = 0; index < n_items; index++) {
+            auto record = Record{ uint32_t(index), uint16_t(index >> 3), 0, 7, double(index) };
+            bitbuffer.write_record<RecordSchema>(record);
+        }
+        auto n_bytes = bitbuffer.buffer().size();
+        g_checksum = g_checksum + n_bytes;
+
+        return { n_bytes, n_items };
+    }
+
+    Result read_record(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitbuffer.write_record<RecordSchema>(Record{ uint32_t(index), uint16_t(index >> 3), 0, 7, double(index) });
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += bitbuffer.read_record<RecordSchema>().id;
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { bitbuffer.buffer().size(), n_items };
+    }
+
+    // A record of 8 fields, written field by field or in a single batch.
+    // The buffer is reserved, so that page faults do not hide the cost per field.
+    template<bool Batched>
+    Result write_fields(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        auto bitbuffer = BitBuffer();
+        bitbuffer.reserve(n_items * 14);
+        for (std::size_t index = 0; index < n_items; index++) {
+            auto id = uint32_t(index);
+            if constexpr (Batched) {
+                bitbuffer.write_fields(std::pair{ id, 20 }, std::pair{ uint8_t(id), 3 }, std::pair{ id >> 3, 12 },
+                    std::pair{ uint16_t(id), 9 }, std::pair{ id * 7, 17 }, std::pair{ uint8_t(1), 1 },
+                    std::pair{ id, 6 }, std::pair{ uint64_t(id) << 20, 40 });
+            } else {
+                bitbuffer.write_bits(id, 20);
+                bitbuffer.write_bits(uint8_t(id), 3);
+                bitbuffer.write_bits(id >> 3, 12);
+                bitbuffer.write_bits(uint16_t(id), 9);
+                bitbuffer.write_bits(id * 7, 17);
+                bitbuffer.write_bits(uint8_t(1), 1);
+                bitbuffer.write_bits(id, 6);
+                bitbuffer.write_bits(uint64_t(id) << 20, 40);
+            }
+        }
+        auto n_bytes = bitbuffer.buffer().size();
+        g_checksum = g_checksum + n_bytes;
+
+        return { n_bytes, n_items };
+    }
+
+    Result read_fields(std::size_t scale) {
+        auto n_items = N_ITEMS / 4 * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitbuffer.write_fields(std::pair{ uint32_t(index), 20 }, std::pair{ uint64_t(index) << 20, 40 });
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            auto [id, shifted] = bitbuffer.read_fields<uint32_t, u64>(20, 40);
+            checksum += id + shifted;
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { bitbuffer.buffer().size(), n_items };
+    }
+
+    // Small values with a geometric-like spread, as in residual coding.
+    u64 residual(std::size_t index) {
+        auto hash = index * 0x9e3779b97f4a7c15;
+        return (hash >> 60) << (hash >> 62);
+    }
+
+    Result write_exp_golomb(std::size_t scale) {
+        auto n_items = N_ITEMS * scale;
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t index = 0; index < n_items; index++) {
+            bitbuffer.write_exp_golomb(residual(index));
+        }
+        auto n_bytes = bitbuffer.buffer().size();
+        g_checksum = g_checksum + n_bytes;
+
+        return { n_bytes, n_items };
+    }
+
+    Result read_exp_golomb(std::size_t scale) {
+        auto n_items = N_ITEMS * scale;
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitbuffer.write_exp_golomb(residual(index));
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += bitbuffer.read_exp_golomb();
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { bitbuffer.buffer().size(), n_items };
+    }
+
+    // Bytes with a skewed distribution, about 4 bits of entropy each.
+    const std::vector<u8>& text_symbols() {
+        static const auto symbols = [] {
+            auto generator = std::mt19937_64(7);
+            auto distribution = std::geometric_distribution<int>(0.12);
+            auto drawn = std::vector<u8>(N_ITEMS);
+            for (auto& symbol : drawn) {
+                symbol = static_cast<u8>(std::min(distribution(generator), 255));
+            }
+            return drawn;
+        }();
+
+        return symbols;
+    }
+
+    const HuffmanCode& text_code() {
+        static const auto code = [] {
+            auto frequencies = std::vector<u64>(256);
+            for (auto symbol : text_symbols()) {
+                frequencies[symbol]++;
+            }
+            return HuffmanCode::from_frequencies(frequencies);
+        }();
+
+        return code;
+    }
+
+    Result huffman_encode(std::size_t scale) {
+        const auto& symbols = text_symbols();
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t run = 0; run < scale; run++) {
+            text_code().encode(std::span<const u8>(symbols), bitbuffer);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { symbols.size() * scale, symbols.size() * scale };
+    }
+
+    // Throughput is measured on the decoded bytes.
+    Result huffman_decode(std::size_t scale) {
+        const auto& symbols = text_symbols();
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t run = 0; run < scale; run++) {
+                text_code().encode(std::span<const u8>(symbols), bitbuffer);
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        static const auto decoder = HuffmanDecoder(text_code());
+        auto decoded = std::vector<u8>(symbols.size());
+        for (std::size_t run = 0; run < scale; run++) {
+            decoder.decode(bitbuffer, std::span<u8>(decoded));
+        }
+        g_checksum = g_checksum + decoded.back();
+
+        return { symbols.size() * scale, symbols.size() * scale };
+    }
+
+    // Timestamps of irregular events, a few milliseconds apart.
+    const std::vector<u64>& timestamps() {
+        static const auto drawn = [] {
+            auto generator = std::mt19937_64(42);
+            auto distribution = std::uniform_int_distribution<u64>(1, 5000);
+            auto values = std::vector<u64>(N_ITEMS);
+            u64 timestamp = 1'700'000'000'000'000;
+            for (auto& value : values) {
+                value = timestamp += distribution(generator);
+            }
+            return values;
+        }();
+
+        return drawn;
+    }
+
+    // Throughput is measured on the raw 64-bit values.
+    Result int_block_encode(std::size_t scale) {
+        const auto& values = timestamps();
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t run = 0; run < scale; run++) {
+            IntBlockCodec::encode(values, bitbuffer);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { values.size() * sizeof(u64) * scale, values.size() * scale };
+    }
+
+    Result int_block_decode(std::size_t scale) {
+        const auto& values = timestamps();
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t run = 0; run < scale; run++) {
+                IntBlockCodec::encode(values, bitbuffer);
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        auto decoded = std::vector<u64>(values.size());
+        for (std::size_t run = 0; run < scale; run++) {
+            IntBlockCodec::decode(bitbuffer, decoded);
+        }
+        g_checksum = g_checksum + decoded.back();
+
+        return { values.size() * sizeof(u64) * scale, values.size() * scale };
+    }
+
+    const RansCode& text_rans_code() {
+        static const auto code = [] {
+            auto frequencies = std::vector<u64>(256);
+            for (auto symbol : text_symbols()) {
+                frequencies[symbol]++;
+            }
+            return RansCode::from_frequencies(frequencies);
+        }();
+
+        return code;
+    }
+
+    Result rans_encode(std::size_t scale) {
+        const auto& symbols = text_symbols();
+
+        auto bitbuffer = BitBuffer();
+        for (std::size_t run = 0; run < scale; run++) {
+            text_rans_code().encode(symbols, bitbuffer);
+        }
+        g_checksum = g_checksum + bitbuffer.buffer().size();
+
+        return { symbols.size() * scale, symbols.size() * scale };
+    }
+
+    // Throughput is measured on the decoded bytes, as for 'huffman_decode'.
+    Result rans_decode(std::size_t scale) {
+        const auto& symbols = text_symbols();
+
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = BitBuffer();
+            for (std::size_t run = 0; run < scale; run++) {
+                text_rans_code().encode(symbols, bitbuffer);
+            }
+            filled_scale = scale;
+        }
+
+        bitbuffer.write_bits(0, 0);
+
+        static const auto decoder = RansDecoder(text_rans_code());
+        auto decoded = std::vector<u8>(symbols.size());
+        for (std::size_t run = 0; run < scale; run++) {
+            decoder.decode(bitbuffer, decoded);
+        }
+        g_checksum = g_checksum + decoded.back();
+
+        return { symbols.size() * scale, symbols.size() * scale };
+    }
+
+    // Half of the bits set at random, 2^28 bits per scale.
+    const std::vector<u8>& random_bitmap(std::size_t scale) {
+        static auto bitmap = std::vector<u8>();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            auto generator = std::mt19937_64(42);
+            bitmap.resize((std::size_t(1) << 25) * scale);
+            for (std::size_t offset = 0; offset < bitmap.size(); offset += sizeof(u64)) {
+                auto word = store_word(generator());
+                std::memcpy(bitmap.data() + offset, word.data(), word.size());
+            }
+            filled_scale = scale;
+        }
+
+        return bitmap;
+    }
+
+    const BitVector& random_bitvector(std::size_t scale) {
+        static auto bitvector = BitVector();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            const auto& bitmap = random_bitmap(scale);
+            bitvector = BitVector(bitmap, bitmap.size() * BYTE_BITS);
+            filled_scale = scale;
+        }
+
+        return bitvector;
+    }
+
+    // Arguments below 'bound' drawn once per bound, so the queries are not
+    // slowed down by the generator.
+    const std::vector<std::size_t>& random_queries(std::size_t bound) {
+        static auto queries = std::vector<std::size_t>();
+        static std::size_t drawn_bound = 0;
+        if (drawn_bound != bound) {
+            auto generator = std::mt19937_64(42);
+            auto distribution = std::uniform_int_distribution<std::size_t>(0, bound - 1);
+            queries.resize(N_ITEMS);
+            for (auto& query : queries) {
+                query = distribution(generator);
+            }
+            drawn_bound = bound;
+        }
+
+        return queries;
+    }
+
+    Result bitvector_build(std::size_t scale) {
+        const auto& bitmap = random_bitmap(scale);
+
+        auto bitvector = BitVector(bitmap, bitmap.size() * BYTE_BITS);
+        g_checksum = g_checksum + bitvector.count_ones();
+
+        return { bitmap.size(), 1 };
+    }
+
+    // Independent queries at random positions of the bitmap, so only
+    // 'ns_per_op' is meaningful.
+    template<typename Query>
+    Result bitvector_queries(std::size_t bound, Query query) {
+        const auto& queries = random_queries(bound);
+
+        u64 checksum = 0;
+        for (auto argument : queries) {
+            checksum += query(argument);
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { 0, queries.size() };
+    }
+
+    Result bitvector_access(std::size_t scale) {
+        const auto& bitvector = random_bitvector(scale);
+        return bitvector_queries(bitvector.size_in_bits(), [&](std::size_t position) {
+            return bitvector.access(position);
+        });
+    }
+
+    Result bitvector_rank(std::size_t scale) {
+        const auto& bitvector = random_bitvector(scale);
+        return bitvector_queries(bitvector.size_in_bits() + 1, [&](std::size_t position) {
+            return bitvector.rank1(position);
+        });
+    }
+
+    Result bitvector_select(std::size_t scale) {
+        const auto& bitvector = random_bitvector(scale);
+        return bitvector_queries(bitvector.count_ones(), [&](std::size_t rank) {
+            return bitvector.select1(rank);
+        });
+    }
+
+    // A producer writes bursts of values that a consumer drains right away.
+    Result fifo_interleaved(std::size_t scale) {
+        const std::size_t width = 19;
+        const std::size_t burst_length = 64;
+        auto n_items = N_ITEMS * scale;
+
+        auto queue = BitBuffer(BufferMode::fifo);
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index += burst_length) {
+            for (std::size_t offset = 0; offset < burst_length; offset++) {
+                queue.write_bits(index + offset, width);
+            }
+            for (std::size_t offset = 0; offset < burst_length; offset++) {
+                checksum += queue.read_bits_as<uint32_t>(width);
+            }
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { BitBuffer::from_bits_to_bytes_length(width * n_items), 2 * n_items };
+    }
+
+    // A producer thread streams values to the consumer, the calling thread.
+    Result bit_channel(std::size_t scale) {
+        const std::size_t width = 19;
+        auto n_items = N_ITEMS * scale;
+
+        auto channel = BitChannel();
+        auto producer = std::jthread([&] {
+            for (std::size_t index = 0; index < n_items; index++) {
+                channel.write_bits(index, width);
+            }
+            channel.close();
+        });
+
+        u64 checksum = 0;
+        for (std::size_t index = 0; index < n_items; index++) {
+            checksum += channel.read_bits_as<uint32_t>(width);
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { BitBuffer::from_bits_to_bytes_length(width * n_items), 2 * n_items };
+    }
+
+    BitBuffer& large_buffer(std::size_t scale) {
+        static auto bitbuffer = BitBuffer();
+        static std::size_t filled_scale = 0;
+        if (filled_scale != scale) {
+            bitbuffer = filled_with_fixed_width(WORD_BITS, FILE_BYTES * scale / sizeof(u64));
+            filled_scale = scale;
+        }
+
+        return bitbuffer;
+    }
+
+    // Writes the file read by the scenarios below, once per scale.
+    void create_bench_file(std::size_t scale) {
+        static std::size_t written_scale = 0;
+        if (written_scale != scale) {
+            large_buffer(scale).write_as_file(BENCH_FILE);
+            written_scale = scale;
+        }
+    }
+
+    Result write_file(std::size_t scale) {
+        large_buffer(scale).write_as_file(BENCH_FILE);
+        return { FILE_BYTES * scale, 1 };
+    }
+
+    // Encodes values into a file as they are produced, the file being
+    // written inline or by the thread of 'AsyncFileSink'.
+    template<bool Async>
+    Result encode_to_file(std::size_t scale) {
+        const std::size_t width = 61;
+        auto n_items = FILE_BYTES * scale * BYTE_BITS / width;
+
+        auto encode = [&](ByteSink& sink) {
+            auto bitwriter = BitWriter(sink, std::size_t(1) << 20);
+            for (std::size_t index = 0; index < n_items; index++) {
+                bitwriter.write_bits(index * 0x9e3779b97f4a7c15, width);
+            }
+            bitwriter.finish();
+        };
+
+        if constexpr (Async) {
+            auto sink = AsyncFileSink(BENCH_FILE);
+            encode(sink);
+            sink.close();
+        } else {
+            auto* file = std::fopen(BENCH_FILE, "wb");
+            auto sink = FileSink(file);
+            encode(sink);
+            std::fclose(file);
+        }
+
+        return { BitBuffer::from_bits_to_bytes_length(width * n_items), n_items };
+    }
+
+    Result read_file(std::size_t scale) {
+        create_bench_file(scale);
+
+        auto bitbuffer = BitBuffer();
+        bitbuffer.read_from_file(BENCH_FILE);
+        g_checksum = g_checksum + bitbuffer.read_as<u64>();
+
+        return { FILE_BYTES * scale, 1 };
+    }
+
+    // Maps the file and reads all of it, so every page is faulted in.
+    Result read_mapped_file(std::size_t scale) {
+        create_bench_file(scale);
+
+        auto bitbuffer = BitBuffer();
+        bitbuffer.read_from_file(BENCH_FILE, MapOptions{});
+
+        u64 checksum = 0;
+        auto n_words = FILE_BYTES * scale / sizeof(u64);
+        for (std::size_t index = 0; index < n_words; index++) {
+            checksum += bitbuffer.read_as<u64>();
+        }
+        g_checksum = g_checksum + checksum;
+
+        return { FILE_BYTES * scale, n_words };
+    }
+
+    const Scenario SCENARIOS[] = {
+        { "write_bits_fixed", write_bits_fixed },
+        { "write_bits_random", write_bits_random },
+        { "read_bits_as_fixed", read_bits_fixed },
+        { "read_bits_as_random", read_bits_random },
+        { "bit_reader_lsb_random", read_random_span<BitOrder::lsb_first> },
+        { "bit_reader_msb_random", read_random_span<BitOrder::msb_first> },
+        { "write_struct", write_struct },
+        { "read_as_struct", read_struct },
+        { "write_record", write_record },
+        { "read_record", read_record },
+        { "write_fields", write_fields<true> },
+        { "write_fields_sequential", write_fields<false> },
+        { "read_fields", read_fields },
+        { "write_exp_golomb", write_exp_golomb },
+        { "read_exp_golomb", read_exp_golomb },
+        { "huffman_encode", huffman_encode },
+        { "huffman_decode", huffman_decode },
+        { "rans_encode", rans_encode },
+        { "rans_decode", rans_decode },
+        { "int_block_encode", int_block_encode },
+        { "int_block_decode", int_block_decode },
+        { "bitvector_build", bitvector_build },
+        { "bitvector_access", bitvector_access },
+        { "bitvector_rank", bitvector_rank },
+        { "bitvector_select", bitvector_select },
+        { "fifo_interleaved", fifo_interleaved },
+        { "bit_channel", bit_channel },
+        { "write_as_file", write_file },
+        { "encode_to_file", encode_to_file<false> },
+        { "encode_to_file_async", encode_to_file<true> },
+        { "read_from_file", read_file },
+        { "read_from_mapped_file", read_mapped_file },
+    };
+}
+
+int main(int argc, char** argv) {
+    auto filter = std::string_view(argc > 1 ? argv[1] : "");
+    std::size_t scale = argc > 2 ? std::stoul(argv[2]) : 1;
+
+    std::println("name,bytes,ops,seconds,mb_per_s,ns_per_op");
+
+    for (const auto& scenario : SCENARIOS) {
+        if (scenario.name.find(filter) == std::string_view::npos) {
+            continue;
+        }
+
+        // The first run also builds the inputs kept between runs.
+        auto best_seconds = std::numeric_limits<double>::max();
+        Result result{};
+        for (int run = 0; run < N_RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            result = scenario.run(scale);
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+            best_seconds = std::min(best_seconds, elapsed.count());
+        }
+
+        std::println("{},{},{},{:.6f},{:.1f},{:.2f}",
+                scenario.name,
+                result.bytes,
+                result.ops,
+                best_seconds,
+                double(result.bytes) / best_seconds / 1e6,
+                best_seconds * 1e9 / double(result.ops));
+        std::fflush(stdout);
+    }
+
+    std::remove(BENCH_FILE);
+}
@@ -2,8 +2,22 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <thread>
+#include <numeric>
+#include <random>
 #include <utest.h>
 #include <BitBuffer.hpp>
+#include <BitReader.hpp>
+#include <BitWriter.hpp>
+#include <ChunkedBitReader.hpp>
+#include <Huffman.hpp>
+#include <Rans.hpp>
+#include <Segmented.hpp>
+#include <IntBlockCodec.hpp>
+#include <BitVector.hpp>
+#include <BitChannel.hpp>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace outbit;
 
@@ -29,7 +43,7 @@ UTEST(BitBuffer, roundtrip) {
         bit_writer.write_bits(value, bit_count);
     }
 
-    auto writer_output = std::vector<u8>(bit_writer.buffer());
+    auto writer_output = std::vector<u8>(bit_writer.buffer().begin(), bit_writer.buffer().end());
 
     auto bit_reader = BitBuffer();
     auto new_bit_writer = BitBuffer();
@@ -117,6 +131,36 @@ UTEST(BitBuffer, read_bits_as) {
     */
 }
 
+UTEST(BitBuffer, read_bits_as_across_words) {
+    auto data = std::vector<u8>(24);
+    for (std::size_t index = 0; index < data.size(); index++) {
+        data[index] = u8(index * 37 + 11);
+    }
+
+    auto bitbuff = BitBuffer();
+    bitbuff.read_from_vector(data);
+
+    ASSERT_EQ(bitbuff.read_bits_as<u8>(3), data[0] & 0b111);
+    auto expected = uint64_t(0);
+    std::memcpy(&expected, data.data(), sizeof(expected));
+    ASSERT_EQ(bitbuff.read_bits_as<uint64_t>(61), expected >> 3);
+
+    std::memcpy(&expected, data.data() + 8, sizeof(expected));
+    ASSERT_EQ(bitbuff.read_bits_as<uint64_t>(64), expected);
+    ASSERT_EQ(bitbuff.read_bits_as<int>(9), data[16] | (data[17] & 1) << 8);
+}
+
+UTEST(BitBuffer, read_bits_as_after_sub_byte_writes) {
+    auto bitbuff = BitBuffer();
+    bitbuff.write_bits(0b101, 3);
+    bitbuff.write_bits(0b10, 2);
+    bitbuff.write_bits(0b1101101, 7);
+
+    ASSERT_EQ(bitbuff.read_bits_as<int>(3), 0b101);
+    ASSERT_EQ(bitbuff.read_bits_as<int>(2), 0b10);
+    ASSERT_EQ(bitbuff.read_bits_as<int>(7), 0b1101101);
+}
+
 // TODO: Add more operations
 UTEST(BitBuffer, alternating_write_and_read_ops) {
     auto bitbuff = BitBuffer();
@@ -149,6 +193,942 @@ UTEST(BitBuffer, alternating_write_and_read_ops) {
     ASSERT_EQ(read_ints.c, myints.c);
 }
 
+UTEST(BitBuffer, write_after_loading_empty_input) {
+    auto bitbuff = BitBuffer();
+    bitbuff.write_bits(0b101, 3);
+    ASSERT_EQ(bitbuff.buffer().size(), std::size_t(1));
+
+    auto empty = std::vector<u8>();
+    bitbuff.read_from_vector(empty);
+    ASSERT_EQ(bitbuff.size_in_bits(), std::size_t(0));
+
+    bitbuff.write_bits(0b11, 2);
+    ASSERT_EQ(bitbuff.size_in_bits(), std::size_t(2));
+    ASSERT_EQ(bitbuff.read_bits_as<int>(2), 0b11);
+}
+
+UTEST(BitBuffer, fifo_mode) {
+    auto bitbuff = BitBuffer(BufferMode::fifo);
+
+    // Reads that catch up with a partially written tail byte
+    bitbuff.write_bits(0b101, 3);
+    ASSERT_EQ(bitbuff.read_bits_as<int>(2), 0b01);
+    bitbuff.write_bits(0b11011, 5);
+    ASSERT_EQ(bitbuff.read_bits_as<int>(6), 0b110111);
+    ASSERT_EQ(bitbuff.unread_bits(), std::size_t(0));
+
+    std::size_t n_written = 0;
+    std::size_t n_read = 0;
+    std::size_t largest_capacity = 0;
+    for (std::size_t round = 0; round < 2000; round++) {
+        for (std::size_t index = 0; index < 50; index++, n_written++) {
+            bitbuff.write_bits(n_written * 2654435761u, n_written % 29 + 1);
+        }
+
+        for (std::size_t index = 0; index < 50; index++, n_read++) {
+            auto n_bits = n_read % 29 + 1;
+            auto expected = (n_read * 2654435761u) & low_bits_mask(n_bits);
+            ASSERT_EQ(bitbuff.read_bits_as<uint64_t>(n_bits), expected);
+        }
+
+        largest_capacity = std::max(largest_capacity, bitbuff.buffer().capacity());
+    }
+
+    // 100k values went through, but only about one round is kept in memory
+    ASSERT_LT(largest_capacity, std::size_t(1024));
+
+    bitbuff.write_bits(0b1011, 4);
+    bitbuff.shrink_to_fit();
+    ASSERT_LE(bitbuff.buffer().size(), std::size_t(2));
+    ASSERT_EQ(bitbuff.read_bits_as<int>(4), 0b1011);
+}
+
+UTEST(BitBuffer, write_and_read_packed) {
+    auto values = std::vector<uint32_t>(1003);
+    for (std::size_t index = 0; index < values.size(); index++) {
+        values[index] = uint32_t(index * 2654435761u);
+    }
+
+    for (std::size_t width = 0; width <= 32; width++) {
+        for (std::size_t head_bits : { 0, 3, 61 }) {
+            auto packed = BitBuffer();
+            auto sequential = BitBuffer();
+            packed.write_bits(uint64_t(0x5555555555555555), head_bits);
+            sequential.write_bits(uint64_t(0x5555555555555555), head_bits);
+
+            packed.write_packed(std::span<const uint32_t>(values), width);
+            for (auto value : values) {
+                sequential.write_bits(value, width);
+            }
+            packed.write_bits(0b101, 3);
+            sequential.write_bits(0b101, 3);
+
+            ASSERT_TRUE(packed.buffer() == sequential.buffer());
+
+            auto read = std::vector<uint32_t>(values.size());
+            packed.read_bits_as<uint64_t>(head_bits);
+            packed.read_packed(std::span<uint32_t>(read), width);
+            for (std::size_t index = 0; index < values.size(); index++) {
+                ASSERT_EQ(read[index], uint32_t(values[index] & low_bits_mask(width)));
+            }
+            ASSERT_EQ(packed.read_bits_as<int>(3), 0b101);
+        }
+    }
+
+    auto small_values = std::vector<int16_t>{ -1, 2, -3, 4, -5, 6, -7, 8, -9, 10 };
+    auto bitbuff = BitBuffer();
+    bitbuff.write_packed(std::span<const int16_t>(small_values), 5);
+    auto read = std::vector<int16_t>(small_values.size());
+    bitbuff.read_packed(std::span<int16_t>(read), 5);
+    ASSERT_EQ(read[0], 0b11111);
+    ASSERT_EQ(read[9], 10);
+}
+
+UTEST(BitPacking, pack_kernel_matches_scalar) {
+    static constexpr auto scalar_kernels =
+        make_pack_kernels<uint32_t>(std::make_index_sequence<MAX_PACKED_WIDTH + 1>{});
+
+    auto values = std::vector<uint32_t>(203);
+    for (std::size_t index = 0; index < values.size(); index++) {
+        values[index] = uint32_t(index * 2246822519u);
+    }
+
+    for (std::size_t width = 0; width <= MAX_PACKED_WIDTH; width++) {
+        for (std::size_t head_bits : { 0, 7, 63 }) {
+            auto n_bytes = (head_bits + values.size() * width) / WORD_BITS * sizeof(u64);
+            auto output = std::vector<u8>(n_bytes);
+            auto scalar_output = std::vector<u8>(n_bytes);
+
+            auto accumulator = BitAccumulator();
+            auto scalar_accumulator = BitAccumulator();
+            accumulator.push(low_bits_mask(head_bits), head_bits, [](u64) {});
+            scalar_accumulator.push(low_bits_mask(head_bits), head_bits, [](u64) {});
+
+            auto* end = pack_kernel<uint32_t>(width)(values.data(), values.size(), accumulator, output.data());
+            auto* scalar_end = scalar_kernels[width](values.data(), values.size(), scalar_accumulator, scalar_output.data());
+
+            ASSERT_EQ(end - output.data(), scalar_end - scalar_output.data());
+            ASSERT_TRUE(output == scalar_output);
+            ASSERT_EQ(accumulator.size(), scalar_accumulator.size());
+            ASSERT_EQ(accumulator.bits(), scalar_accumulator.bits());
+        }
+    }
+}
+
+UTEST(BitBuffer, write_and_read_fields) {
+    for (std::size_t head_bits : { 0, 5, 63 }) {
+        auto batched = BitBuffer();
+        auto sequential = BitBuffer();
+        batched.write_bits(uint64_t(0x5555555555555555), head_bits);
+        sequential.write_bits(uint64_t(0x5555555555555555), head_bits);
+
+        for (uint32_t index = 0; index < 100; index++) {
+            batched.write_fields(std::pair{ index, 7 }, std::pair{ uint8_t(index * 3), 0 },
+                std::pair{ uint64_t(index) << 40 | 0xabc, 64 }, std::pair{ char('a' + index % 26), 5 });
+            sequential.write_bits(index, 7);
+            sequential.write_bits(uint8_t(index * 3), 0);
+            sequential.write_bits(uint64_t(index) << 40 | 0xabc, 64);
+            sequential.write_bits(char('a' + index % 26), 5);
+        }
+        batched.write_bits(0b101, 3);
+        sequential.write_bits(0b101, 3);
+
+        ASSERT_TRUE(batched.buffer() == sequential.buffer());
+
+        batched.read_bits_as<uint64_t>(head_bits);
+        for (uint32_t index = 0; index < 100; index++) {
+            auto [small, empty, wide, letter] = batched.read_fields<uint32_t, uint8_t, uint64_t, char>(7, 0, 64, 5);
+            ASSERT_EQ(small, index & 0x7f);
+            ASSERT_EQ(empty, 0);
+            ASSERT_EQ(wide, uint64_t(index) << 40 | 0xabc);
+            ASSERT_EQ(letter, char(('a' + index % 26) & 0x1f));
+        }
+        ASSERT_EQ(batched.read_bits_as<int>(3), 0b101);
+    }
+}
+
+UTEST(BitBuffer, compile_time_widths) {
+    auto fixed = BitBuffer();
+    auto runtime = BitBuffer();
+
+    for (uint64_t value = 0; value < 100; value++) {
+        fixed.write_bits<3>(value);
+        runtime.write_bits(value, 3);
+        fixed.write_bits(value * 977, 17);
+        runtime.write_bits<17>(value * 977);
+        fixed.write_bits<64>(~value);
+        runtime.write_bits(~value, 64);
+    }
+    fixed.write_bits<0>(uint8_t(1));
+
+    ASSERT_TRUE(fixed.buffer() == runtime.buffer());
+
+    for (uint64_t value = 0; value < 100; value++) {
+        ASSERT_EQ(fixed.read_bits_as<uint64_t>(3), value % 8);
+        ASSERT_EQ((fixed.read_bits<17, uint32_t>()), uint32_t(value * 977 % (1 << 17)));
+        ASSERT_EQ((fixed.read_bits<64, uint64_t>()), ~value);
+    }
+}
+
+UTEST(BitBuffer, variable_length_codes) {
+    auto bitbuffer = BitBuffer();
+    bitbuffer.write_unary(3);
+    bitbuffer.write_exp_golomb(3);
+    bitbuffer.write_rice(13, 2);
+    // 0b1000, then 0b00100, then 0b1000 followed by 0b01
+    ASSERT_EQ(bitbuffer.buffer()[0], 0b01001000);
+    ASSERT_EQ(bitbuffer.buffer()[1], 0b00110000);
+
+    bitbuffer.write_leb128(300);
+    bitbuffer.write_zigzag(-2);
+    ASSERT_EQ(bitbuffer.buffer().size(), std::size_t(5));
+    ASSERT_EQ(bitbuffer.buffer()[2], 0b10101100);
+    ASSERT_EQ(bitbuffer.buffer()[3], 0b00000010);
+    ASSERT_EQ(bitbuffer.buffer()[4], 3);
+
+    ASSERT_EQ(bitbuffer.read_unary(), u64(3));
+    ASSERT_EQ(bitbuffer.read_exp_golomb(), u64(3));
+    ASSERT_EQ(bitbuffer.read_rice(2), u64(13));
+    ASSERT_EQ(bitbuffer.read_leb128(), u64(300));
+    ASSERT_EQ(bitbuffer.read_zigzag(), int64_t(-2));
+}
+
+UTEST(BitBuffer, variable_length_codes_roundtrip) {
+    auto values = std::vector<u64>{ 0, 1, 2, 63, 64, 65, 127, 1000, 1 << 20,
+        u64(1) << 31, u64(1) << 32, u64(1) << 62, ~u64(0) - 1 };
+
+    auto bitbuffer = BitBuffer();
+    for (auto value : values) {
+        bitbuffer.write_exp_golomb(value);
+        bitbuffer.write_rice(value % 5000, 3);
+        bitbuffer.write_unary(value % 200);
+        bitbuffer.write_leb128(value);
+        bitbuffer.write_zigzag(-static_cast<int64_t>(value / 2));
+        bitbuffer.write_bits(u8(5), 3);
+    }
+
+    for (auto value : values) {
+        ASSERT_EQ(bitbuffer.read_exp_golomb(), value);
+        ASSERT_EQ(bitbuffer.read_rice(3), value % 5000);
+        ASSERT_EQ(bitbuffer.read_unary(), value % 200);
+        ASSERT_EQ(bitbuffer.read_leb128(), value);
+        ASSERT_EQ(bitbuffer.read_zigzag(), -static_cast<int64_t>(value / 2));
+        ASSERT_EQ(bitbuffer.read_bits_as<u8>(3), 5);
+    }
+    ASSERT_EQ(bitbuffer.unread_bits(), std::size_t(0));
+}
+
+UTEST(BitBuffer, peek_and_consume_bits) {
+    auto bitbuffer = BitBuffer();
+    bitbuffer.write_bits(0b10110, 5);
+
+    ASSERT_EQ(bitbuffer.peek_bits(3), u64(0b110));
+    ASSERT_EQ(bitbuffer.peek_bits(8), u64(0b10110));
+    bitbuffer.consume_bits(2);
+    ASSERT_EQ(bitbuffer.read_bits_as<int>(3), 0b101);
+    ASSERT_EQ(bitbuffer.peek_bits(4), u64(0));
+}
+
+UTEST(Huffman, roundtrip) {
+    auto symbols = std::vector<uint16_t>();
+    auto frequencies = std::vector<u64>(300);
+    for (std::size_t index = 0; index < 20000; index++) {
+        auto symbol = static_cast<uint16_t>(std::countr_zero(index * 0x9e3779b97f4a7c15 | (u64(1) << 40)) * 7 % 300);
+        symbols.push_back(symbol);
+        frequencies[symbol]++;
+    }
+
+    auto code = HuffmanCode::from_frequencies(frequencies);
+    auto bitbuffer = BitBuffer();
+    code.encode(std::span<const uint16_t>(symbols), bitbuffer);
+    bitbuffer.write_bits(0b11, 2);
+
+    auto decoder = HuffmanDecoder(code);
+    auto decoded = std::vector<uint16_t>(symbols.size());
+    decoder.decode(bitbuffer, std::span<uint16_t>(decoded));
+    ASSERT_TRUE(decoded == symbols);
+    ASSERT_EQ(bitbuffer.read_bits_as<int>(2), 0b11);
+}
+
+UTEST(Huffman, long_codes) {
+    // Fibonacci frequencies give a maximally skewed tree, 29 levels deep.
+    auto frequencies = std::vector<u64>{ 1, 1 };
+    while (frequencies.size() < 30) {
+        frequencies.push_back(frequencies[frequencies.size() - 1] + frequencies[frequencies.size() - 2]);
+    }
+
+    auto code = HuffmanCode::from_frequencies(frequencies);
+    ASSERT_EQ(code.max_length(), HuffmanCode::MAX_CODE_LENGTH);
+
+    u64 kraft_sum = 0;
+    for (auto length : code.lengths()) {
+        kraft_sum += u64(1) << (HuffmanCode::MAX_CODE_LENGTH - length);
+    }
+    ASSERT_EQ(kraft_sum, u64(1) << HuffmanCode::MAX_CODE_LENGTH);
+
+    auto rebuilt = HuffmanCode::from_lengths(code.lengths());
+    auto bitbuffer = BitBuffer();
+    for (std::size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+        rebuilt.encode(symbol, bitbuffer);
+    }
+
+    auto decoder = HuffmanDecoder(code);
+    for (std::size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+        ASSERT_EQ(decoder.decode(bitbuffer), symbol);
+    }
+
+    auto oversubscribed = std::vector<u8>{ 1, 1, 1 };
+    ASSERT_EXCEPTION(HuffmanCode::from_lengths(oversubscribed), std::runtime_error);
+}
+
+UTEST(BitBuffer, seek_and_skip_bits) {
+    // Records of 23 bits, located through their bit offsets
+    const std::size_t record_bits = 23;
+    auto bitbuffer = BitBuffer();
+    for (uint32_t record = 0; record < 1000; record++) {
+        bitbuffer.write_bits(record * 7919, record_bits);
+    }
+
+    for (uint32_t record : { 999u, 0u, 500u, 501u, 13u }) {
+        bitbuffer.seek_bits(record * record_bits);
+        ASSERT_EQ(bitbuffer.tell_bits(), record * record_bits);
+        ASSERT_EQ(bitbuffer.read_bits_as<uint32_t>(record_bits), (record * 7919) & low_bits_mask(record_bits));
+        ASSERT_EQ(bitbuffer.tell_bits(), (record + 1) * record_bits);
+    }
+
+    bitbuffer.seek_bits(0);
+    bitbuffer.skip_bits(5);
+    bitbuffer.skip_bits(record_bits - 5);
+    ASSERT_EQ(bitbuffer.read_bits_as<uint32_t>(record_bits), uint32_t(7919));
+    bitbuffer.skip_bits(100 * record_bits);
+    ASSERT_EQ(bitbuffer.read_bits_as<uint32_t>(record_bits), uint32_t(102 * 7919));
+
+    // Positions count the bytes dropped in FIFO mode
+    auto queue = BitBuffer(BufferMode::fifo);
+    for (std::size_t value = 0; value < 4096; value++) {
+        queue.write_bits(value, 16);
+        ASSERT_EQ(queue.read_bits_as<std::size_t>(16), value);
+    }
+    ASSERT_EQ(queue.tell_bits(), std::size_t(4096 * 16));
+    queue.write_bits(0xabcd, 16);
+    queue.write_bits(0x1234, 16);
+    queue.skip_bits(16);
+    ASSERT_EQ(queue.read_bits_as<int>(16), 0x1234);
+    queue.seek_bits(4096 * 16);
+    ASSERT_EQ(queue.read_bits_as<int>(16), 0xabcd);
+}
+
+UTEST(SegmentedCodec, roundtrip) {
+    const std::size_t n_segments = 37;
+    auto encode_segment = [](std::size_t segment, BitBuffer& output) {
+        for (std::size_t index = 0; index < segment * 100; index++) {
+            output.write_exp_golomb(index ^ segment);
+        }
+        output.write_bits(segment, 7);
+    };
+
+    auto single_thread = SegmentedCodec(1).encode(n_segments, encode_segment);
+    auto encoded = SegmentedCodec(4).encode(n_segments, encode_segment);
+    ASSERT_TRUE(encoded.buffer() == single_thread.buffer());
+
+    // Decoded on the worker threads, checked afterwards.
+    auto matches = std::vector<int>(n_segments);
+    auto n_decoded = SegmentedCodec(3).decode(encoded, [&](std::size_t segment, BitReader& input) {
+        auto reference = BitBuffer();
+        encode_segment(segment, reference);
+        matches[segment] = std::ranges::equal(input.bytes(), reference.buffer());
+    });
+
+    ASSERT_EQ(n_decoded, n_segments);
+    ASSERT_EQ(std::count(matches.begin(), matches.end(), 1), std::ptrdiff_t(n_segments));
+
+    auto truncated = std::vector<u8>(encoded.buffer().begin(), encoded.buffer().end() - 1);
+    ASSERT_EXCEPTION(SegmentedCodec().decode(std::span<const u8>(truncated), [](std::size_t, BitReader&) {}),
+            std::runtime_error);
+}
+
+UTEST(SegmentedCodec, reuses_its_threads) {
+    auto codec = SegmentedCodec(4);
+    auto encode_segment = [](std::size_t segment, BitBuffer& output) {
+        output.write_bits(segment, 13);
+    };
+    auto reference = SegmentedCodec(1).encode(9, encode_segment);
+
+    std::size_t mismatches = 0;
+    for (std::size_t call = 0; call < 500; call++) {
+        mismatches += codec.encode(9, encode_segment).buffer() != reference.buffer();
+    }
+    ASSERT_EQ(mismatches, 0u);
+
+    // The first exception is rethrown once every task ran.
+    auto n_runs = std::atomic<std::size_t>(0);
+    ASSERT_EXCEPTION(codec.encode(20, [&](std::size_t segment, BitBuffer&) {
+        n_runs++;
+        if (segment % 3 == 0) {
+            throw std::runtime_error("segment");
+        }
+    }), std::runtime_error);
+    ASSERT_EQ(n_runs.load(), 20u);
+
+    // A task may use the codec, its tasks then run on the task's thread.
+    auto nested = codec.encode(4, [&](std::size_t segment, BitBuffer& output) {
+        output.write_bytes(codec.encode(segment, encode_segment).buffer());
+    });
+    ASSERT_EQ(codec.decode(nested, [](std::size_t, BitReader&) {}), 4u);
+}
+
+UTEST(BitBuffer, write_bytes) {
+    auto bytes = std::vector<u8>(100);
+    std::iota(bytes.begin(), bytes.end(), u8(7));
+
+    for (std::size_t head_bits : { 0, 3, 8 }) {
+        auto bulk = BitBuffer();
+        auto sequential = BitBuffer();
+        bulk.write_bits(0b101, head_bits);
+        sequential.write_bits(0b101, head_bits);
+
+        bulk.write_bytes(bytes);
+        for (auto byte : bytes) {
+            sequential.write(byte);
+        }
+        bulk.write_bits(0b11, 2);
+        sequential.write_bits(0b11, 2);
+
+        ASSERT_TRUE(bulk.buffer() == sequential.buffer());
+        ASSERT_EQ(bulk.size_in_bits(), head_bits + bytes.size() * BYTE_BITS + 2);
+    }
+}
+
+namespace {
+    enum class Status : uint8_t { idle, active, fault };
+
+    struct Telemetry {
+        uint64_t timestamp;
+        uint32_t sensor_id;
+        int32_t temperature;
+        uint16_t humidity;
+        bool alarm;
+        uint8_t battery;
+        Status status;
+        double reading;
+    };
+
+    using TelemetrySchema = Schema<
+        Field<&Telemetry::timestamp, 34>,
+        Field<&Telemetry::sensor_id, 10>,
+        Field<&Telemetry::temperature, 11>,
+        Field<&Telemetry::humidity, 7>,
+        Field<&Telemetry::alarm, 1>,
+        Field<&Telemetry::battery, 7>,
+        Field<&Telemetry::status, 2>,
+        Field<&Telemetry::reading, 64>>;
+}
+
+UTEST(BitBuffer, write_and_read_record) {
+    static_assert(TelemetrySchema::size_in_bits == 136);
+    static_assert(TelemetrySchema::pack(Telemetry{ 1, 0, -1, 0, true, 0, Status::fault, 0.0 })[0]
+            == (1 | (u64(0x7ff) << 44) | (u64(1) << 62)));
+
+    auto bitbuffer = BitBuffer();
+    bitbuffer.write_bits(0b101, 3);
+    for (int index = 0; index < 100; index++) {
+        auto record = Telemetry{ u64(index) << 27, uint32_t(index * 9), index - 50, uint16_t(index),
+            index % 3 == 0, uint8_t(index), Status(index % 3), index * 0.25 };
+        bitbuffer.write_record<TelemetrySchema>(record);
+    }
+
+    ASSERT_EQ(bitbuffer.buffer().size(), std::size_t((3 + 100 * 136 + 7) / 8));
+
+    ASSERT_EQ(bitbuffer.read_bits_as<int>(3), 0b101);
+    for (int index = 0; index < 100; index++) {
+        auto record = bitbuffer.read_record<TelemetrySchema>();
+        ASSERT_EQ(record.timestamp, u64(index) << 27);
+        ASSERT_EQ(record.sensor_id, uint32_t(index * 9));
+        ASSERT_EQ(record.temperature, index - 50);
+        ASSERT_EQ(record.humidity, uint16_t(index));
+        ASSERT_EQ(record.alarm, index % 3 == 0);
+        ASSERT_EQ(record.battery, uint8_t(index));
+        ASSERT_TRUE(record.status == Status(index % 3));
+        ASSERT_EQ(record.reading, index * 0.25);
+    }
+}
+
+UTEST(IntBlockCodec, roundtrip) {
+    // Constant stride, then a partial block of noisy, decreasing and wide values.
+    auto values = std::vector<u64>();
+    for (u64 index = 0; index < 300; index++) {
+        values.push_back(1'700'000'000'000 + index * 1000);
+    }
+    for (u64 index = 0; index < 200; index++) {
+        values.push_back(5'000 - index * 7 + (index * 2654435761u) % 13);
+    }
+    for (u64 index = 0; index < 150; index++) {
+        values.push_back(index % 2 ? std::numeric_limits<u64>::max() - index : index << 40);
+    }
+    values.push_back(42);
+
+    auto bitbuffer = BitBuffer();
+    IntBlockCodec::encode(values, bitbuffer);
+    // The first two blocks only store their headers.
+    ASSERT_LT(bitbuffer.size_in_bits(), values.size() * 64 / 2);
+
+    auto decoded = std::vector<u64>(values.size());
+    IntBlockCodec::decode(bitbuffer, decoded);
+    ASSERT_TRUE(decoded == values);
+}
+
+UTEST(BitBuffer, memory_resource) {
+    // The arena has no upstream, so any allocation past it throws.
+    auto arena = std::array<std::byte, 1 << 16>();
+    auto resource = std::pmr::monotonic_buffer_resource(arena.data(), arena.size(), std::pmr::null_memory_resource());
+
+    auto bitbuffer = BitBuffer(&resource);
+    auto reference = BitBuffer();
+    for (std::size_t index = 0; index < 1000; index++) {
+        bitbuffer.write_bits(index, index % 23);
+        reference.write_bits(index, index % 23);
+    }
+
+    ASSERT_TRUE(bitbuffer.resource() == &resource);
+    ASSERT_TRUE(std::ranges::equal(bitbuffer.buffer(), reference.buffer()));
+
+    auto moved = std::move(bitbuffer);
+    ASSERT_TRUE(moved.resource() == &resource);
+    ASSERT_EQ(moved.read_bits_as<int>(1), 1);
+}
+
+UTEST(FixedBitWriter, overflow) {
+    auto bytes = std::array<u8, 10>();
+    auto writer = FixedBitWriter(bytes);
+    auto reference = BitBuffer();
+    for (std::size_t index = 0; index < 7; index++) {
+        ASSERT_TRUE(writer.write_bits(index * 997, 11));
+        reference.write_bits(index * 997, 11);
+    }
+
+    // 77 bits written, a 3 bit write still fits and a 1 bit one does not after it.
+    ASSERT_FALSE(writer.write(u8(0xff)));
+    ASSERT_EQ(writer.written_bits(), std::size_t(77));
+    ASSERT_TRUE(writer.write_bits(0b101, 3));
+    reference.write_bits(0b101, 3);
+    ASSERT_FALSE(writer.write_bits(1, 1));
+    ASSERT_TRUE(writer.overflowed());
+
+    auto written = writer.finish();
+    ASSERT_EQ(written.size(), bytes.size());
+    ASSERT_TRUE(std::ranges::equal(written, reference.buffer()));
+}
+
+struct TablePair {
+    uint16_t low;
+    uint16_t high;
+};
+
+// Encoded at compile time, the same way a table baked into a binary would be.
+template<BitOrder Order>
+constexpr std::array<u8, 48> encode_table() {
+    auto bytes = std::array<u8, 48>();
+    auto writer = BasicFixedBitWriter<Order>(bytes);
+    for (uint32_t index = 0; index < 20; index++) {
+        writer.write_bits(index * 997, 13);
+    }
+    if constexpr (Order == BitOrder::lsb_first) {
+        writer.write(TablePair{ 0x1234, 0xabcd });
+        writer.write(uint64_t(0x0123456789abcdef));
+    }
+    writer.finish();
+    assert(!writer.overflowed());
+
+    return bytes;
+}
+
+UTEST(FixedBitWriter, compile_time_table) {
+    constexpr auto table = encode_table<BitOrder::lsb_first>();
+    constexpr auto msb_table = encode_table<BitOrder::msb_first>();
+    constexpr auto serialized = BitBuffer::serialize(TablePair{ 0x1234, 0xabcd });
+
+    static_assert(BitReader(std::span<const u8>(table)).read_bits_as<uint32_t>(13) == 0);
+    static_assert([&] {
+        auto reader = BitReader(std::span<const u8>(table));
+        reader.consume_bits(13);
+        return reader.read_bits<13, uint32_t>() == 997;
+    }());
+    static_assert([&] {
+        auto reader = MsbBitReader(std::span<const u8>(msb_table));
+        reader.consume_bits(13);
+        return reader.read_bits_as<uint32_t>(13) == 997;
+    }());
+    static_assert(serialized[0] == 0x34 && serialized[3] == 0xab);
+
+    auto reference = BitBuffer();
+    auto msb_reference = std::array<u8, 48>();
+    auto msb_writer = MsbFixedBitWriter(msb_reference);
+    for (uint32_t index = 0; index < 20; index++) {
+        reference.write_bits(index * 997, 13);
+        msb_writer.write_bits(index * 997, 13);
+    }
+    reference.write(TablePair{ 0x1234, 0xabcd });
+    reference.write(uint64_t(0x0123456789abcdef));
+    msb_writer.finish();
+
+    ASSERT_TRUE(std::ranges::equal(std::span<const u8>(table).first(reference.buffer().size()), reference.buffer()));
+    ASSERT_TRUE(msb_table == msb_reference);
+
+    auto reader = BitReader(std::span<const u8>(table));
+    for (uint32_t index = 0; index < 20; index++) {
+        ASSERT_EQ(reader.read_bits_as<uint32_t>(13), (index * 997) & 0x1fff);
+    }
+    auto pair = reader.read_as<TablePair>();
+    ASSERT_EQ(pair.high, 0xabcd);
+    ASSERT_EQ(reader.read_as<uint64_t>(), uint64_t(0x0123456789abcdef));
+}
+
+UTEST(BitBuffer, stats) {
+    auto bitbuffer = BitBuffer();
+    u64 n_reallocations = 0;
+    auto hooks = BufferHooks();
+    hooks.on_reallocation = [&](std::size_t, std::size_t) {
+        n_reallocations++;
+    };
+    bitbuffer.set_hooks(hooks);
+
+    for (int index = 0; index < 1000; index++) {
+        bitbuffer.write_bits(index, 13);
+    }
+    for (int index = 0; index < 500; index++) {
+        ASSERT_EQ(bitbuffer.read_bits_as<int>(13), index);
+    }
+    bitbuffer.read_exp_golomb();
+    auto n_read_bits = bitbuffer.tell_bits();
+
+    auto filepath = fs::temp_directory_path() / "outbit_stats.bin";
+    bitbuffer.write_as_file(filepath);
+    fs::remove(filepath);
+
+    auto stats = bitbuffer.stats();
+    if constexpr (STATS_ENABLED) {
+        ASSERT_EQ(stats.write_calls, u64(1000));
+        ASSERT_EQ(stats.written_bits, u64(13000));
+        ASSERT_EQ(stats.read_calls, u64(501));
+        ASSERT_EQ(stats.read_bits, u64(n_read_bits));
+        ASSERT_GT(stats.reallocations, u64(0));
+        ASSERT_EQ(stats.reallocations, n_reallocations);
+        ASSERT_EQ(stats.file_writes, u64(1));
+        ASSERT_EQ(stats.file_written_bytes, u64(1625));
+    } else {
+        ASSERT_EQ(stats.write_calls, u64(0));
+        ASSERT_EQ(n_reallocations, u64(0));
+        ASSERT_GT(n_read_bits, std::size_t(500 * 13));
+    }
+
+    bitbuffer.reset_stats();
+    ASSERT_EQ(bitbuffer.stats().written_bits, u64(0));
+}
+
+UTEST(MsbBitReader, big_endian_fields) {
+    static constexpr auto bytes = std::array<u8, 6>{ 0x12, 0x34, 0x56, 0x78, 0b10111001, 0xff };
+    auto reader = MsbBitReader(std::span<const u8>(bytes));
+
+    auto first = reader.read_bits<16, uint16_t>();
+    ASSERT_EQ(first, 0x1234);
+    ASSERT_EQ(reader.peek_bits(8), u64(0x56));
+    ASSERT_EQ(reader.read_as<uint16_t>(), 0x5678);
+    ASSERT_EQ(reader.read_bits_as<int>(3), 0b101);
+    ASSERT_EQ(reader.read_bits_as<int>(2), 0b11);
+    ASSERT_EQ(reader.read_bits_as<int>(11), 0x1ff);
+    ASSERT_EQ(reader.peek_bits(4), u64(0));
+
+    auto written = std::array<u8, 2>();
+    auto writer = MsbFixedBitWriter(written);
+    writer.write_bits(0b101, 3);
+    writer.write_bits(0b11, 2);
+    writer.write_bits(0x1ff, 11);
+    ASSERT_TRUE(std::ranges::equal(writer.finish(), std::span(bytes).last(2)));
+}
+
+UTEST(MsbBitWriter, roundtrip) {
+    auto sink = MemorySink();
+    auto writer = MsbBitWriter(sink, 64);
+    for (std::size_t index = 0; index < 3000; index++) {
+        writer.write_bits(index * 0x9e3779b97f4a7c15, index % 65);
+    }
+    writer.finish();
+
+    auto reader = MsbBitReader(std::span<const u8>(sink.bytes()));
+    for (std::size_t index = 0; index < 3000; index++) {
+        ASSERT_EQ(reader.read_bits_as<u64>(index % 65), index * 0x9e3779b97f4a7c15 & low_bits_mask(index % 65));
+    }
+    ASSERT_LT(reader.remaining_bits(), std::size_t(BYTE_BITS));
+}
+
+UTEST(AsyncFileSink, matches_bitbuffer) {
+    auto filepath = fs::temp_directory_path() / "outbit_async_file_sink.bin";
+
+    auto bitbuff = BitBuffer();
+    {
+        // Small buffers, so most writes wait for the thread.
+        auto sink = AsyncFileSink(filepath, 100);
+        auto bitwriter = BitWriter(sink, 64);
+        for (std::size_t index = 0; index < 20000; index++) {
+            bitwriter.write_bits(index * 40503u, index % 33);
+            bitbuff.write_bits(index * 40503u, index % 33);
+        }
+        bitwriter.finish();
+        sink.close();
+        ASSERT_EXCEPTION(sink.write(std::span<const u8>(bitbuff.buffer())), std::runtime_error);
+    }
+
+    auto written = BitBuffer();
+    written.read_from_file(filepath);
+    ASSERT_TRUE(written.buffer() == bitbuff.buffer());
+    fs::remove(filepath);
+
+    // Writes that fail on the thread are reported by the calls that follow them.
+    auto full = AsyncFileSink("/dev/full", 16);
+    ASSERT_EXCEPTION(full.write(std::span<const u8>(bitbuff.buffer())), std::runtime_error);
+    ASSERT_EXCEPTION(full.flush(), std::runtime_error);
+    ASSERT_EXCEPTION(full.close(), std::runtime_error);
+
+    ASSERT_EXCEPTION(AsyncFileSink(fs::path("/nonexistent/outbit.bin")), std::runtime_error);
+}
+
+UTEST(Rans, roundtrip) {
+    // A skewed source: about 0.2 bits per symbol, where Huffman needs 1.
+    auto generator = std::mt19937(7);
+    auto symbols = std::vector<u8>(100003);
+    auto frequencies = std::vector<u64>(256);
+    for (auto& symbol : symbols) {
+        symbol = generator() % 100 < 98 ? 0 : static_cast<u8>(1 + generator() % 3);
+        frequencies[symbol]++;
+    }
+
+    auto code = RansCode::from_frequencies(frequencies);
+    ASSERT_EQ(std::accumulate(code.frequencies().begin(), code.frequencies().end(), std::size_t(0)),
+            RansCode::PROB_SCALE);
+
+    auto bitbuffer = BitBuffer();
+    bitbuffer.write_bits(0b101, 3);
+    code.encode(symbols, bitbuffer);
+    bitbuffer.write_bits(0b11, 2);
+    ASSERT_LT(bitbuffer.size_in_bits(), symbols.size() / 4);
+
+    auto decoder = RansDecoder(RansCode::from_scaled_frequencies(code.frequencies()));
+    auto decoded = std::vector<u8>(symbols.size());
+    ASSERT_EQ(bitbuffer.read_bits_as<int>(3), 0b101);
+    decoder.decode(bitbuffer, decoded);
+    ASSERT_EQ(bitbuffer.read_bits_as<int>(2), 0b11);
+    ASSERT_TRUE(decoded == symbols);
+
+    // A single symbol takes no bits past the states.
+    auto single = std::vector<u8>(1000, 9);
+    auto single_frequencies = std::vector<u64>(10);
+    single_frequencies[9] = 1;
+    auto single_buffer = BitBuffer();
+    RansCode::from_frequencies(single_frequencies).encode(single, single_buffer);
+    ASSERT_EQ(single_buffer.size_in_bits(), RansCode::N_STATES * 32);
+
+    auto invalid = std::vector<uint16_t>{ 1000, 1000 };
+    ASSERT_EXCEPTION(RansCode::from_scaled_frequencies(invalid), std::runtime_error);
+}
+
+UTEST(BitVector, rank_select) {
+    // Sparse, dense and constant stretches, around block and superblock boundaries.
+    auto generator = std::mt19937_64(7);
+    auto bits = std::vector<bool>();
+    for (std::size_t index = 0; index < 50'000; index++) {
+        bits.push_back(generator() % 64 == 0);
+    }
+    for (std::size_t index = 0; index < 20'000; index++) {
+        bits.push_back(generator() % 8 != 0);
+    }
+    bits.insert(bits.end(), 9000, true);
+    bits.insert(bits.end(), 9000, false);
+    bits.push_back(true);
+
+    auto bitbuffer = BitBuffer();
+    for (auto bit : bits) {
+        bitbuffer.write_bits(static_cast<u8>(bit), 1);
+    }
+    auto bitvector = BitVector(bitbuffer.bytes(), bits.size());
+    ASSERT_EQ(bitvector.size_in_bits(), bits.size());
+    ASSERT_LT(bitvector.index_size_in_bytes() * BYTE_BITS, bits.size() * 6 / 100);
+
+    std::size_t rank = 0;
+    for (std::size_t position = 0; position < bits.size(); position++) {
+        ASSERT_EQ(bitvector.access(position), bits[position]);
+        ASSERT_EQ(bitvector.rank1(position), rank);
+        if (bits[position]) {
+            ASSERT_EQ(bitvector.select1(rank), position);
+            rank++;
+        }
+    }
+    ASSERT_EQ(bitvector.rank1(bits.size()), rank);
+    ASSERT_EQ(bitvector.rank0(bits.size()), bits.size() - rank);
+    ASSERT_EQ(bitvector.count_ones(), rank);
+}
+
+UTEST(BitVector, boundary_sizes) {
+    for (std::size_t n_bits : {0, 1, 63, 64, 511, 512, 4095, 4096, 4097, 8192}) {
+        // All ones, with garbage past the end.
+        auto bytes = std::vector<u8>(n_bits / BYTE_BITS + 1, 0xff);
+        auto bitvector = BitVector(bytes, n_bits);
+
+        ASSERT_EQ(bitvector.count_ones(), n_bits);
+        ASSERT_EQ(bitvector.rank1(n_bits), n_bits);
+        for (std::size_t position = 0; position < n_bits; position += 61) {
+            ASSERT_EQ(bitvector.rank1(position), position);
+            ASSERT_EQ(bitvector.select1(position), position);
+        }
+    }
+}
+
+UTEST(BitVector, fifo_buffer) {
+    auto bitbuff = BitBuffer(BufferMode::fifo);
+    std::size_t n_written = 0;
+    for (std::size_t round = 0; round < 200; round++) {
+        for (std::size_t index = 0; index < 50; index++, n_written++) {
+            bitbuff.write_bits(n_written * 2654435761u, 13);
+        }
+        for (std::size_t index = 0; index < 40; index++) {
+            bitbuff.read_bits_as<uint64_t>(13);
+        }
+    }
+    bitbuff.write_bits(0b101, 3);
+
+    auto bytes = bitbuff.bytes();
+    ASSERT_LT(bytes.size() * BYTE_BITS, bitbuff.size_in_bits());
+
+    auto bitvector = BitVector(bitbuff);
+    // Ends with the last bits written.
+    auto n_bits = bitvector.size_in_bits();
+    ASSERT_EQ(n_bits % BYTE_BITS, bitbuff.size_in_bits() % BYTE_BITS);
+    ASSERT_EQ((n_bits + BYTE_BITS - 1) / BYTE_BITS, bytes.size());
+    ASSERT_TRUE(bitvector.access(n_bits - 1));
+    ASSERT_FALSE(bitvector.access(n_bits - 2));
+    ASSERT_TRUE(bitvector.access(n_bits - 3));
+
+    std::size_t n_ones = 0;
+    for (std::size_t position = 0; position < n_bits; position++) {
+        auto bit = (bytes[position / BYTE_BITS] >> (position % BYTE_BITS)) & 1;
+        ASSERT_EQ(bitvector.access(position), bit == 1);
+        n_ones += bit;
+    }
+    ASSERT_EQ(bitvector.count_ones(), n_ones);
+}
+
+UTEST(BitChannel, bounded_ring) {
+    ASSERT_EQ(BitChannel(8).capacity_in_bits(), 256u);
+    auto channel = BitChannel(32);
+    ASSERT_EQ(channel.capacity_in_bits(), 256u);
+
+    // Nothing is readable until a word is complete or flushed.
+    ASSERT_TRUE(channel.try_write_bits(0b10110, 5));
+    ASSERT_FALSE(channel.try_read_bits_as<int>(5).has_value());
+    channel.flush();
+    ASSERT_EQ(channel.try_read_bits_as<int>(5).value(), 0b10110);
+
+    // The ring is full until the consumer is done with a whole word.
+    ASSERT_TRUE(channel.try_write_bits(u64(0xdeadbeef), 64));
+    ASSERT_TRUE(channel.try_write_bits(u64(0x5555), 64));
+    ASSERT_TRUE(channel.try_write_bits(u64(0x6666), 64));
+    ASSERT_TRUE(channel.try_write_bits(u64(0x1234), 59));
+    ASSERT_FALSE(channel.try_write_bits(1, 1));
+    ASSERT_EQ(channel.read_bits_as<u64>(59), u64(0xdeadbeef));
+    ASSERT_TRUE(channel.try_write_bits(1, 1));
+
+    channel.close();
+    ASSERT_EQ(channel.readable_bits(), 5u + 64u + 64u + 59u + 1u);
+    ASSERT_EQ(channel.read_bits_as<u64>(5), u64(0));
+    ASSERT_EQ(channel.read_bits_as<u64>(64), u64(0x5555));
+    ASSERT_EQ(channel.read_bits_as<u64>(64), u64(0x6666));
+    ASSERT_EQ(channel.read_bits_as<u64>(59), u64(0x1234));
+    ASSERT_FALSE(channel.at_end());
+    ASSERT_EXCEPTION(channel.read_bits_as<int>(2), std::runtime_error);
+    ASSERT_EQ(channel.read_bits_as<int>(1), 1);
+    ASSERT_TRUE(channel.at_end());
+}
+
+UTEST(BitChannel, producer_and_consumer_threads) {
+    const std::size_t n_items = 200'000;
+    auto width = [](std::size_t index) { return index * 7 % 64 + 1; };
+    auto value = [&](std::size_t index) { return (index * 0x9e3779b97f4a7c15) & low_bits_mask(width(index)); };
+
+    // A small ring, so both threads keep waiting for each other.
+    auto channel = BitChannel(64);
+    auto producer = std::jthread([&] {
+        for (std::size_t index = 0; index < n_items; index++) {
+            channel.write_bits(value(index), width(index));
+            if (index % 1000 == 0) {
+                channel.flush();
+            }
+        }
+        channel.close();
+    });
+
+    std::size_t mismatches = 0;
+    for (std::size_t index = 0; index < n_items; index++) {
+        mismatches += channel.read_bits_as<u64>(width(index)) != value(index);
+    }
+    producer.join();
+
+    ASSERT_EQ(mismatches, 0u);
+    ASSERT_TRUE(channel.at_end());
+}
+
+UTEST(BitChannel, smallest_ring) {
+    const std::size_t n_items = 20'000;
+
+    // Reads end inside the words the producer has not completed yet.
+    auto channel = BitChannel(16);
+    auto producer = std::jthread([&] {
+        for (std::size_t index = 0; index < n_items; index++) {
+            channel.write_bits(index * 0x2545f491 & low_bits_mask(30), 30);
+        }
+        channel.close();
+    });
+
+    std::size_t mismatches = 0;
+    for (std::size_t index = 0; index < n_items; index++) {
+        auto low = channel.read_bits_as<u64>(20);
+        auto high = channel.read_bits_as<u64>(10);
+        mismatches += (low | high << 20) != (index * 0x2545f491 & low_bits_mask(30));
+    }
+    producer.join();
+
+    ASSERT_EQ(mismatches, 0u);
+    ASSERT_TRUE(channel.at_end());
+}
+
+UTEST(BitChannel, wide_items_in_smallest_ring) {
+    const std::size_t n_rounds = 5'000;
+    auto value = [](std::size_t index, std::size_t n_bits) { return (index * 0x9e3779b97f4a7c15) & low_bits_mask(n_bits); };
+
+    // The consumer waits for 64 bits from the middle of a word, the
+    // producer for room for 64 bits.
+    auto channel = BitChannel(16);
+    auto producer = std::jthread([&] {
+        for (std::size_t index = 0; index < n_rounds; index++) {
+            channel.write_bits(value(index, 63), 63);
+            channel.write_bits(value(index, 37), 37);
+            channel.write_bits(value(index, 64), 64);
+        }
+        channel.close();
+    });
+
+    std::size_t mismatches = 0;
+    for (std::size_t index = 0; index < n_rounds; index++) {
+        mismatches += channel.read_bits_as<u64>(63) != value(index, 63);
+        auto both = channel.read_bits_as<u64>(64);
+        mismatches += (both & low_bits_mask(37)) != value(index, 37);
+        auto last = channel.read_bits_as<u64>(37);
+        mismatches += ((both >> 37) | last << 27) != value(index, 64);
+    }
+    producer.join();
+
+    ASSERT_EQ(mismatches, 0u);
+    ASSERT_TRUE(channel.at_end());
+}
+
 // TODO: Add more structs
 UTEST(BitBuffer, write_and_read_of_big_structs) {
     typedef struct integers {
@@ -237,6 +1217,220 @@ UTEST(BitBuffer, write_bits) {
     ASSERT_EQ(bitbuff.tail_byte().value(), 255);
 }
 
+UTEST(BitBuffer, write_bits_across_words) {
+    auto bitbuff = BitBuffer();
+    bitbuff.write_bits(uint64_t(0), 60);
+    bitbuff.write_bits(0b10110111, 8);
+    bitbuff.write_bits(uint64_t(0xFFFFFFFFFFFFFFFF), 64);
+    bitbuff.write_bits(0, 1);
+
+    const auto& buffer = bitbuff.buffer();
+    ASSERT_EQ(buffer.size(), size_t(17));
+    ASSERT_EQ(buffer.at(7), 0b01110000);
+    ASSERT_EQ(buffer.at(8), 0b11111011);
+    ASSERT_EQ(buffer.at(15), 255);
+    ASSERT_EQ(bitbuff.tail_byte().value(), 0b1111);
+
+    // Writing after the buffer was observed continues the partial tail byte.
+    bitbuff.write_bits(0b111, 3);
+    ASSERT_EQ(bitbuff.buffer().size(), size_t(17));
+    ASSERT_EQ(bitbuff.tail_byte().value(), 0b11101111);
+}
+
+UTEST(BitBuffer, read_from_mapped_file) {
+    auto filepath = fs::temp_directory_path() / "outbit_read_from_mapped_file.bin";
+
+    auto bitbuff = BitBuffer();
+    bitbuff.write(int32_t(-53909));
+    bitbuff.write_bits(0b10110110, 8);
+    bitbuff.write_as_file(filepath);
+
+    auto mapped = BitBuffer();
+    mapped.read_from_file(filepath, MapOptions{ .sequential = true, .huge_pages = true });
+    ASSERT_EQ(mapped.read_as<int32_t>(), -53909);
+    ASSERT_EQ(mapped.read_bits_as<int>(8), 0b10110110);
+
+    // Writing copies the mapping into the buffer
+    mapped.write_bits(0b111, 3);
+    bitbuff.write_bits(0b111, 3);
+    ASSERT_TRUE(mapped.buffer() == bitbuff.buffer());
+
+    fs::remove(filepath);
+
+    ASSERT_EXCEPTION(mapped.read_from_file(filepath, MapOptions{}), std::runtime_error);
+    ASSERT_EXCEPTION(mapped.read_from_file(fs::temp_directory_path(), MapOptions{}), std::runtime_error);
+}
+
+UTEST(BitReader, read_bits_as) {
+    auto bitbuff = BitBuffer();
+    bitbuff.write(int16_t(-1234));
+    bitbuff.write_bits(0b1011, 4);
+    bitbuff.write_bits(uint64_t(0x0123456789ABCDEF), 64);
+    auto output = std::vector<u8>(bitbuff.buffer().begin(), bitbuff.buffer().end());
+
+    auto reader = BitReader(std::span<const u8>(output));
+    ASSERT_EQ(reader.size_in_bits(), output.size() * BYTE_BITS);
+    ASSERT_EQ(reader.read_as<int16_t>(), -1234);
+    ASSERT_EQ(reader.read_bits_as<int>(4), 0b1011);
+    ASSERT_EQ(reader.read_as<uint64_t>(), uint64_t(0x0123456789ABCDEF));
+    ASSERT_EQ(reader.remaining_bits(), size_t(4));
+
+    // The reader does not copy the bytes it decodes
+    ASSERT_EQ(reader.bytes().data(), output.data());
+}
+
+UTEST(BitWriter, matches_bitbuffer) {
+    const std::size_t block_size = 16;
+    auto sink = MemorySink();
+    auto bitwriter = BitWriter(sink, block_size);
+    auto bitbuff = BitBuffer();
+
+    for (std::size_t index = 0; index < 1000; index++) {
+        auto value = index * 2654435761u;
+        auto n_bits = index % 33;
+        bitwriter.write_bits(value, n_bits);
+        bitbuff.write_bits(value, n_bits);
+    }
+
+    bitwriter.flush();
+    ASSERT_EQ(bitwriter.written_bits() / BYTE_BITS, sink.bytes().size());
+
+    bitwriter.write(int16_t(-3));
+    bitbuff.write(int16_t(-3));
+    bitwriter.finish();
+
+    ASSERT_TRUE(std::ranges::equal(sink.bytes(), bitbuff.buffer()));
+}
+
+UTEST(BitWriter, bounded_blocks) {
+    const std::size_t block_size = 64;
+    std::size_t n_blocks = 0;
+    std::size_t largest_block = 0;
+    auto sink = CallbackSink([&](std::span<const u8> bytes) {
+        n_blocks++;
+        largest_block = std::max(largest_block, bytes.size());
+    });
+
+    auto bitwriter = BitWriter(sink, block_size);
+    for (std::size_t index = 0; index < 100000; index++) {
+        bitwriter.write_bits(index, 13);
+    }
+    bitwriter.finish();
+
+    ASSERT_GT(n_blocks, std::size_t(100));
+    ASSERT_LT(largest_block, block_size + sizeof(uint64_t));
+}
+
+UTEST(BitWriter, sink_errors_point_at_the_write) {
+    struct LocationSink : ByteSink {
+        std::source_location location;
+        void write(std::span<const u8>, std::source_location caller_location) override {
+            location = caller_location;
+        }
+    };
+
+    auto sink = LocationSink();
+    auto bitwriter = BitWriter(sink, sizeof(u64));
+    bitwriter.write_bits(0b101, 3);
+    auto line = std::source_location::current().line() + 1;
+    bitwriter.write(u64(0xdeadbeef));
+
+    ASSERT_EQ(sink.location.line(), line);
+    ASSERT_TRUE(std::string_view(sink.location.file_name()) == std::source_location::current().file_name());
+}
+
+UTEST(BitWriter, file_sink) {
+    auto* file = std::tmpfile();
+    ASSERT_TRUE(file != nullptr);
+
+    auto sink = FileSink(file);
+    auto bitwriter = BitWriter(sink);
+    bitwriter.write(uint32_t(0xDEADBEEF));
+    bitwriter.write_bits(0b101, 3);
+    bitwriter.finish();
+
+    ASSERT_EQ(std::ftell(file), 5);
+    std::rewind(file);
+    auto bytes = std::array<u8, 5>();
+    ASSERT_EQ(std::fread(bytes.data(), 1, bytes.size(), file), bytes.size());
+    ASSERT_EQ(bytes[0], 0xEF);
+    ASSERT_EQ(bytes[3], 0xDE);
+    ASSERT_EQ(bytes[4], 0b101);
+    std::fclose(file);
+}
+
+UTEST(ChunkedBitReader, reads_across_chunks) {
+    typedef struct integers {
+        int32_t a;
+        uint64_t b;
+        int16_t c;
+    } Integers;
+
+    const Integers myints = {
+        .a = -53909,
+        .b = 2326172,
+        .c = 41,
+    };
+
+    auto bitbuff = BitBuffer();
+    for (std::size_t index = 0; index < 2000; index++) {
+        bitbuff.write_bits(index * 40503u, index % 57);
+        if (index % 100 == 0) {
+            bitbuff.write(myints);
+        }
+    }
+    auto data = std::vector<u8>(bitbuff.buffer().begin(), bitbuff.buffer().end());
+
+    for (auto double_buffered : { false, true }) {
+        // Hand out at most 5 bytes per call, so values straddle the chunks.
+        std::size_t source_offset = 0;
+        auto source = CallbackSource([&](std::span<u8> bytes) {
+            auto n_bytes = std::min({ bytes.size(), std::size_t(5), data.size() - source_offset });
+            std::memcpy(bytes.data(), data.data() + source_offset, n_bytes);
+            source_offset += n_bytes;
+            return n_bytes;
+        });
+
+        auto reader = ChunkedBitReader(source, 16, double_buffered);
+        for (std::size_t index = 0; index < 2000; index++) {
+            auto n_bits = index % 57;
+            ASSERT_EQ(reader.read_bits_as<uint64_t>(n_bits), (index * 40503u) & low_bits_mask(n_bits));
+            if (index % 100 == 0) {
+                auto read_ints = reader.read_as<Integers>();
+                ASSERT_EQ(read_ints.a, myints.a);
+                ASSERT_EQ(read_ints.b, myints.b);
+                ASSERT_EQ(read_ints.c, myints.c);
+            }
+        }
+
+        ASSERT_EQ(BitBuffer::from_bits_to_bytes_length(reader.tell_bits()), data.size());
+        ASSERT_FALSE(reader.can_read(BYTE_BITS));
+    }
+}
+
+UTEST(ChunkedBitReader, fd_source) {
+    auto filepath = fs::temp_directory_path() / "outbit_fd_source.bin";
+
+    auto bitbuff = BitBuffer();
+    for (uint32_t value = 0; value < 10000; value++) {
+        bitbuff.write_bits(value, 14);
+    }
+    bitbuff.write_as_file(filepath);
+
+    auto file_descriptor = ::open(filepath.c_str(), O_RDONLY);
+    ASSERT_TRUE(file_descriptor >= 0);
+
+    auto source = FdSource(file_descriptor);
+    auto reader = ChunkedBitReader(source, 1000, true);
+    for (uint32_t value = 0; value < 10000; value++) {
+        ASSERT_EQ(reader.read_bits_as<uint32_t>(14), value);
+    }
+    ASSERT_EQ(reader.tell_bits(), std::size_t(10000 * 14));
+
+    ::close(file_descriptor);
+    fs::remove(filepath);
+}
+
 UTEST(BitBuffer, const_buffer) {
     auto bitbuff = BitBuffer();
     auto size_before = bitbuff.buffer().size();